@@ -0,0 +1,171 @@
+#include "Bench.h"
+#include "FirstFitReference.h"
+#include "World/ArenaAllocator.h"
+#include "World/Vertex.h"
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+namespace {
+    struct Operation {
+        char kind;
+        uint32_t size;
+        uint32_t id;
+    };
+
+    //data/ArenaTrace.txt, found from the project directory or the repository root
+    std::vector<Operation> LoadTrace() {
+        std::vector<Operation> trace;
+        const char* paths[] = { "data/ArenaTrace.txt", "bench/data/ArenaTrace.txt" };
+        FILE* file = nullptr;
+        for (const char* path : paths) {
+            if ((file = std::fopen(path, "r")))
+                break;
+        }
+        if (!file)
+            return trace;
+        char line[128];
+        while (std::fgets(line, sizeof(line), file)) {
+            Operation operation{ line[0], 0, 0 };
+            if (operation.kind == 'a')
+                std::sscanf(line + 1, "%u %u", &operation.size, &operation.id);
+            else if (operation.kind == 'f')
+                std::sscanf(line + 1, "%u", &operation.id);
+            else if (operation.kind != 'd')
+                continue;
+            trace.push_back(operation);
+        }
+        std::fclose(file);
+        return trace;
+    }
+
+    struct Result {
+        double seconds = 0.0;
+        double fragmentation = 0.0;
+        uint32_t capacity = 0;
+        uint64_t moved = 0;
+    };
+
+    //Replays the trace growing the arena the way MeshArena does, doubling it when an allocation doesn't fit.
+    //Fragmentation is averaged over the frames.
+    template<typename Allocator>
+    Result Replay(const std::vector<Operation>& trace) {
+        Allocator allocator;
+        std::vector<uint32_t> ids;
+        Result result;
+        uint64_t frames = 0;
+        double start = Bench::Now();
+        for (const Operation& operation : trace) {
+            if (operation.kind == 'a') {
+                if (operation.id >= ids.size())
+                    ids.resize(operation.id + 1);
+                ids[operation.id] = allocator.Allocate(operation.size);
+            }
+            else if (operation.kind == 'f') {
+                allocator.Free(ids[operation.id]);
+            }
+            else {
+                result.fragmentation += allocator.EndFrame();
+                frames++;
+            }
+        }
+        result.seconds = Bench::Now() - start;
+        result.fragmentation /= std::max<uint64_t>(frames, 1);
+        result.capacity = allocator.Capacity();
+        result.moved = allocator.moved;
+        return result;
+    }
+
+    struct FirstFit {
+        FirstFitAllocator allocator{ 1 << 20 };
+        //the old allocator is freed by offset and size, so the handle stands for both
+        std::vector<std::pair<uint32_t, uint32_t>> ranges;
+        uint64_t moved = 0;
+
+        uint32_t Allocate(uint32_t size) {
+            uint32_t offset = allocator.Allocate(size);
+            if (offset == FirstFitAllocator::InvalidOffset) {
+                allocator.Grow(std::max(allocator.Capacity() * 2, allocator.Capacity() + size));
+                offset = allocator.Allocate(size);
+            }
+            ranges.emplace_back(offset, size);
+            return (uint32_t)ranges.size() - 1;
+        }
+        void Free(uint32_t handle) {
+            allocator.Free(ranges[handle].first, ranges[handle].second);
+        }
+        double EndFrame() {
+            uint32_t free = allocator.Capacity() - allocator.Used();
+            return free == 0 ? 0.0 : 1.0 - (double)allocator.LargestFree() / free;
+        }
+        uint32_t Capacity() const {
+            return allocator.Capacity();
+        }
+    };
+
+    template<bool Compacting>
+    struct Tlsf {
+        ArenaAllocator allocator{ 1 << 20 };
+        std::vector<ArenaAllocator::Move> moves;
+        uint64_t moved = 0;
+
+        uint32_t Allocate(uint32_t size) {
+            uint32_t handle = allocator.Allocate(size);
+            if (handle == ArenaAllocator::InvalidHandle) {
+                allocator.Grow(std::max(allocator.Capacity() * 2, allocator.Capacity() + size));
+                handle = allocator.Allocate(size);
+            }
+            return handle;
+        }
+        void Free(uint32_t handle) {
+            allocator.Free(handle);
+        }
+        //with ChunkManager's defaults, compact up to 512 KB of vertices a frame while fragmentation is above 0.5
+        double EndFrame() {
+            if (Compacting && allocator.Fragmentation() > 0.5f) {
+                moves.clear();
+                moved += allocator.Compact(512 * 1024 / sizeof(Vertex), moves);
+            }
+            return allocator.Fragmentation();
+        }
+        uint32_t Capacity() const {
+            return allocator.Capacity();
+        }
+    };
+
+    template<typename Allocator>
+    void Run(const char* name, const std::vector<Operation>& trace, size_t operations, size_t frames) {
+        Result best;
+        best.seconds = 1e30;
+        for (int run = 0; run < 5; run++) {
+            Result result = Replay<Allocator>(trace);
+            if (result.seconds < best.seconds)
+                best = result;
+        }
+        char label[96];
+        std::snprintf(label, sizeof(label), "%s, allocate and free", name);
+        Bench::Report(label, best.seconds / operations * 1e9, "ns/op");
+        std::snprintf(label, sizeof(label), "%s, mean fragmentation", name);
+        Bench::Report(label, best.fragmentation, "");
+        std::snprintf(label, sizeof(label), "%s, final capacity", name);
+        Bench::Report(label, best.capacity / 1024.0, "K vertices");
+        if (best.moved) {
+            std::snprintf(label, sizeof(label), "%s, moved per frame", name);
+            Bench::Report(label, (double)best.moved / frames, "vertices");
+        }
+    }
+}
+
+BENCHMARK(ArenaAllocatorTrace) {
+    std::vector<Operation> trace = LoadTrace();
+    if (trace.empty()) {
+        std::printf("  data/ArenaTrace.txt not found, run from the bench or repository directory\n");
+        return;
+    }
+    size_t frames = std::count_if(trace.begin(), trace.end(), [](const Operation& operation) { return operation.kind == 'd'; });
+    size_t operations = trace.size() - frames;
+    std::printf("  %zu allocations and frees over %zu frames\n", operations, frames);
+    Run<FirstFit>("first fit", trace, operations, frames);
+    Run<Tlsf<false>>("TLSF", trace, operations, frames);
+    Run<Tlsf<true>>("TLSF + compaction", trace, operations, frames);
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+
+/// <summary>
+/// Minimal benchmark registry. Each BENCHMARK body times its own loops and prints its results with Report,
+/// so a case can compare a new path against the one it replaced on the same data.
+/// </summary>
+namespace Bench {
+	struct Benchmark {
+		const char* name;
+		void (*run)();
+	};
+
+	inline std::vector<Benchmark>& Registry() {
+		static std::vector<Benchmark> registry;
+		return registry;
+	}
+
+	struct Registrar {
+		Registrar(const char* name, void (*run)()) {
+			Registry().push_back({ name, run });
+		}
+	};
+
+	/// <summary>
+	/// Written with every result, so the optimizer can't drop the work that produced it
+	/// </summary>
+	inline volatile uint64_t sink = 0;
+
+	inline void Consume(uint64_t value) noexcept {
+		sink = sink + value;
+	}
+
+	inline double Now() noexcept {
+		return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	/// <summary>
+	/// Seconds per iteration of the fastest of repeats runs, each calling body iterations times
+	/// </summary>
+	template<typename F>
+	double BestOf(int repeats, int iterations, F&& body) {
+		double best = 1e30;
+		for (int r = 0; r < repeats; r++) {
+			double start = Now();
+			for (int i = 0; i < iterations; i++)
+				body();
+			best = std::min(best, (Now() - start) / iterations);
+		}
+		return best;
+	}
+
+	inline void Report(const char* label, double value, const char* unit) {
+		std::printf("  %-48s %12.2f %s\n", label, value, unit);
+	}
+}
+
+#define BENCHMARK(name) \
+	static void name(); \
+	static Bench::Registrar name##Registrar(#name, name); \
+	static void name()
@@ -0,0 +1,14 @@
+#include "Bench.h"
+#include <cstring>
+
+//Runs every benchmark, or only those whose name contains the first argument
+int main(int argc, char** argv) {
+    const char* filter = argc > 1 ? argv[1] : nullptr;
+    for (const Bench::Benchmark& benchmark : Bench::Registry()) {
+        if (filter && !std::strstr(benchmark.name, filter))
+            continue;
+        std::printf("%s\n", benchmark.name);
+        benchmark.run();
+    }
+    return 0;
+}
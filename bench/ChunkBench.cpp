@@ -0,0 +1,102 @@
+#include "Bench.h"
+#include "World/Chunk.h"
+#include <memory>
+
+namespace {
+    const int ChunkCount = 64;
+
+    //chunks in an 8 x 8 square, far enough from the origin to hit both hills and mountains
+    void Place(Chunk& chunk, int i) {
+        chunk.position = glm::vec2(100 + i % 8, -40 + i / 8);
+    }
+}
+
+BENCHMARK(ChunkGenerate) {
+    std::unique_ptr<Chunk[]> chunks(new Chunk[ChunkCount]);
+    double seconds = Bench::BestOf(3, 1, [&]() {
+        for (int i = 0; i < ChunkCount; i++) {
+            chunks[i].Reset();
+            Place(chunks[i], i);
+            chunks[i].Generate();
+            Bench::Consume(chunks[i].GetHeight(7, 7));
+        }
+    });
+    Bench::Report("Generate", seconds / ChunkCount * 1e6, "us/chunk");
+
+    size_t blockBytes = 0, cpuBytes = 0;
+    for (int i = 0; i < ChunkCount; i++) {
+        blockBytes += chunks[i].MemoryUsage();
+        cpuBytes += chunks[i].CpuBytes();
+    }
+    //what the chunk stored before sections, one int per block
+    const size_t flatBytes = 16 * 16 * 256 * sizeof(int);
+    Bench::Report("block storage", blockBytes / ChunkCount / 1024.0, "KB/chunk");
+    Bench::Report("cpu total", cpuBytes / ChunkCount / 1024.0, "KB/chunk");
+    Bench::Report("flat int array", flatBytes / 1024.0, "KB/chunk");
+}
+
+BENCHMARK(ChunkGetBlock) {
+    std::unique_ptr<Chunk> chunk(new Chunk());
+    Place(*chunk, 27);
+    chunk->Generate();
+    std::vector<int> flat(16 * 16 * 256);
+    for (int x = 0; x < 16; x++)
+        for (int y = 0; y < 16; y++)
+            for (int z = 0; z < 256; z++)
+                flat[(x * 16 + y) * 256 + z] = chunk->GetBlock(x, y, z);
+
+    const int blocks = 16 * 16 * 256;
+    double sections = Bench::BestOf(5, 10, [&]() {
+        uint64_t solid = 0;
+        for (int x = 0; x < 16; x++)
+            for (int y = 0; y < 16; y++)
+                for (int z = 0; z < 256; z++)
+                    solid += chunk->GetBlock(x, y, z) != 0;
+        Bench::Consume(solid);
+    });
+    double array = Bench::BestOf(5, 10, [&]() {
+        uint64_t solid = 0;
+        for (int x = 0; x < 16; x++)
+            for (int y = 0; y < 16; y++)
+                for (int z = 0; z < 256; z++)
+                    solid += flat[(x * 16 + y) * 256 + z] != 0;
+        Bench::Consume(solid);
+    });
+    Bench::Report("GetBlock, sections", sections / blocks * 1e9, "ns/block");
+    Bench::Report("flat int array", array / blocks * 1e9, "ns/block");
+}
+
+BENCHMARK(ChunkBuildMesh) {
+    std::unique_ptr<Chunk[]> chunks(new Chunk[ChunkCount]);
+    for (int i = 0; i < ChunkCount; i++) {
+        Place(chunks[i], i);
+        chunks[i].Generate();
+    }
+    //plain memory behind the ring, the same path the workers take minus the gpu
+    StagingRing ring(std::make_unique<NullStagingBackend>());
+    ring.Create(64 << 20);
+    auto build = [&](MeshingMode mode, size_t& vertices) {
+        vertices = 0;
+        for (int i = 0; i < ChunkCount; i++) {
+            //neighbors inside the square are real, the outer border stands in solid
+            auto at = [&](int x, int y) -> const Chunk* {
+                return x >= 0 && x < 8 && y >= 0 && y < 8 ? &chunks[y * 8 + x] : nullptr;
+            };
+            int x = i % 8, y = i / 8;
+            chunks[i].dirtySections.store(0xFFFF);
+            chunks[i].TakeSnapshot(at(x, y + 1), at(x + 1, y), at(x, y - 1), at(x - 1, y));
+            MeshBuild result = chunks[i].BuildMesh(ring, mode);
+            vertices += result.bytes / sizeof(Vertex);
+            chunks[i].ReleaseStaging(ring);
+        }
+        ring.Submit();
+        ring.Retire();
+    };
+    size_t naiveVertices = 0, greedyVertices = 0;
+    double naive = Bench::BestOf(3, 1, [&]() { build(MeshingMode::Naive, naiveVertices); });
+    double greedy = Bench::BestOf(3, 1, [&]() { build(MeshingMode::Greedy, greedyVertices); });
+    Bench::Report("TakeSnapshot + BuildMesh, naive", naive / ChunkCount * 1e6, "us/chunk");
+    Bench::Report("TakeSnapshot + BuildMesh, greedy", greedy / ChunkCount * 1e6, "us/chunk");
+    Bench::Report("vertices, naive", (double)naiveVertices / ChunkCount, "/chunk");
+    Bench::Report("vertices, greedy", (double)greedyVertices / ChunkCount, "/chunk");
+}
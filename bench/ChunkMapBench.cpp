@@ -0,0 +1,128 @@
+#include "Bench.h"
+#include "World/ChunkMap.h"
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+namespace {
+    const int RenderDistance = 12;
+    const int UnloadMargin = 2;
+
+    //the hash ChunkManager used with std::unordered_map before ChunkMap, which collides along diagonals
+    struct IVec2Hash {
+        size_t operator()(const glm::ivec2& v) const noexcept {
+            return (std::hash<int>()(v.x) ^ (std::hash<int>()(v.y) << 1));
+        }
+    };
+
+    //what each map answers, so both patterns run unchanged against either
+    struct FlatMap {
+        ChunkMap map;
+        Chunk* Find(const glm::ivec2& position) const {
+            return map.Find(position);
+        }
+        void Insert(const glm::ivec2& position, Chunk* chunk) {
+            map.Insert(position, chunk);
+        }
+    };
+    struct NodeMap {
+        std::unordered_map<glm::ivec2, Chunk*, IVec2Hash> map;
+        Chunk* Find(const glm::ivec2& position) const {
+            auto found = map.find(position);
+            return found == map.end() ? nullptr : found->second;
+        }
+        void Insert(const glm::ivec2& position, Chunk* chunk) {
+            map[position] = chunk;
+        }
+    };
+
+    //ChunkManager::BuildScanOffsets, the disk of offsets nearest first
+    std::vector<glm::ivec2> Disk(int radius) {
+        std::vector<glm::ivec2> offsets;
+        for (int x = -radius; x <= radius; x++)
+            for (int y = -radius; y <= radius; y++)
+                if (x * x + y * y <= radius * radius)
+                    offsets.emplace_back(x, y);
+        std::sort(offsets.begin(), offsets.end(), [](const glm::ivec2& a, const glm::ivec2& b) {
+            int distanceA = a.x * a.x + a.y * a.y;
+            int distanceB = b.x * b.x + b.y * b.y;
+            if (distanceA != distanceB)
+                return distanceA < distanceB;
+            return a.x != b.x ? a.x < b.x : a.y < b.y;
+        });
+        return offsets;
+    }
+
+    //The world as ChunkManager keeps it around center, every chunk out to the unload radius. The chunks are never read, only their addresses.
+    template<typename Map>
+    void Load(Map& map, const glm::ivec2& center) {
+        uintptr_t address = 4096;
+        for (const glm::ivec2& offset : Disk(RenderDistance + UnloadMargin)) {
+            map.Insert(center + offset, reinterpret_cast<Chunk*>(address));
+            address += 64;
+        }
+    }
+
+    //The draw loop of ChunkManager::Update, one Find per offset of the view disk around the player
+    template<typename Map>
+    uint64_t SpiralScan(const Map& map, const glm::ivec2& center, const std::vector<glm::ivec2>& offsets) {
+        uint64_t found = 0;
+        for (const glm::ivec2& offset : offsets)
+            found += (uintptr_t)map.Find(center + offset);
+        return found;
+    }
+
+    //The chunk lookup of ChunkManager::GetGlobalBlock, for the blocks the physics and block picking ask about:
+    //a box around the player, who walks across chunk borders, and a ray cast out from the eye
+    template<typename Map>
+    uint64_t GlobalBlocks(const Map& map, const glm::vec3& player, const glm::vec3& look) {
+        uint64_t found = 0;
+        auto lookup = [&](const glm::ivec3& position) {
+            int chunkX = static_cast<int>(std::floor(position.x / 16.0f));
+            int chunkY = static_cast<int>(std::floor(position.y / 16.0f));
+            found += (uintptr_t)map.Find(glm::ivec2(chunkX, chunkY));
+        };
+        for (int x = -1; x <= 1; x++)
+            for (int y = -1; y <= 1; y++)
+                for (int z = -1; z <= 2; z++)
+                    lookup(glm::ivec3(glm::floor(player)) + glm::ivec3(x, y, z));
+        for (int step = 0; step < 80; step++)
+            lookup(glm::ivec3(glm::floor(player + look * (step * 0.1f))));
+        return found;
+    }
+
+    template<typename Map>
+    void Run(const char* name, const glm::ivec2& center) {
+        Map map;
+        Load(map, center);
+        std::vector<glm::ivec2> offsets = Disk(RenderDistance);
+        double scan = Bench::BestOf(5, 200, [&]() { Bench::Consume(SpiralScan(map, center, offsets)); });
+        //a 64 block walk across four chunk borders, weaving and turning as it goes
+        const int steps = 1000;
+        double blocks = Bench::BestOf(5, 20, [&]() {
+            for (int step = 0; step < steps; step++) {
+                float t = step / (float)steps;
+                glm::vec3 player(center.x * 16.0f - 24.0f + 64.0f * t, center.y * 16.0f + 8.0f * std::sin(t * 20.0f), 80.0f);
+                glm::vec3 look(std::cos(t * 7.0f), std::sin(t * 7.0f), -0.3f);
+                Bench::Consume(GlobalBlocks(map, player, look));
+            }
+        });
+        //9 * 4 blocks around the player plus 80 steps of the ray
+        const int lookups = steps * (36 + 80);
+        char label[96];
+        std::snprintf(label, sizeof(label), "%s, spiral scan of %zu chunks", name, offsets.size());
+        Bench::Report(label, scan / offsets.size() * 1e9, "ns/lookup");
+        std::snprintf(label, sizeof(label), "%s, GetGlobalBlock pattern", name);
+        Bench::Report(label, blocks / lookups * 1e9, "ns/lookup");
+    }
+}
+
+BENCHMARK(ChunkMapLookup) {
+    //near the origin, and far out along a diagonal where x ^ (y << 1) collides the most
+    const glm::ivec2 centers[] = { { 0, 0 }, { 3000, 3000 } };
+    for (const glm::ivec2& center : centers) {
+        std::printf("  around chunk (%d, %d)\n", center.x, center.y);
+        Run<FlatMap>("ChunkMap", center);
+        Run<NodeMap>("unordered_map", center);
+    }
+}
@@ -0,0 +1,75 @@
+#include "Bench.h"
+#include "World/Chunk.h"
+#include <memory>
+
+namespace {
+    //what face culling did before the opacity masks, six GetBlock calls per solid block, reaching into the neighbor chunks at the border
+    uint64_t CountFacesPerVoxel(const Chunk& chunk, const Chunk* const (&neighbors)[4]) {
+        static const int offsets[6][3] = { { 0, 1, 0 }, { 0, -1, 0 }, { -1, 0, 0 }, { 1, 0, 0 }, { 0, 0, -1 }, { 0, 0, 1 } };
+        uint64_t faces = 0;
+        for (int x = 0; x < 16; x++) {
+            for (int y = 0; y < 16; y++) {
+                for (int z = 0; z < 256; z++) {
+                    if (chunk.GetBlock(x, y, z) == 0)
+                        continue;
+                    for (const int(&offset)[3] : offsets) {
+                        int nx = x + offset[0], ny = y + offset[1], nz = z + offset[2];
+                        if (nz < 0 || nz > 255) {
+                            faces++;
+                            continue;
+                        }
+                        const Chunk* owner = ny > 15 ? neighbors[0] : nx > 15 ? neighbors[1] : ny < 0 ? neighbors[2] : nx < 0 ? neighbors[3] : &chunk;
+                        faces += owner->GetBlock(nx & 15, ny & 15, nz) == 0;
+                    }
+                }
+            }
+        }
+        return faces;
+    }
+
+    uint64_t CountBits(const ColumnMask& mask) {
+        uint64_t bits = 0;
+        mask.ForEachSetBit([&](int) { bits++; });
+        return bits;
+    }
+}
+
+BENCHMARK(FaceCulling) {
+    std::unique_ptr<Chunk[]> chunks(new Chunk[5]);
+    const glm::vec2 offsets[5] = { { 0, 0 }, { 0, 1 }, { 1, 0 }, { 0, -1 }, { -1, 0 } };
+    for (int i = 0; i < 5; i++) {
+        chunks[i].position = glm::vec2(37, -12) + offsets[i];
+        chunks[i].Generate();
+    }
+    const Chunk* const neighbors[4] = { &chunks[1], &chunks[2], &chunks[3], &chunks[4] };
+    Chunk& chunk = chunks[0];
+    chunk.dirtySections.store(0xFFFF);
+    chunk.TakeSnapshot(neighbors[0], neighbors[1], neighbors[2], neighbors[3]);
+
+    static Chunk::FaceMasks faceMasks;
+    auto masks = [&]() {
+        uint64_t any = 0;
+        for (int x = 0; x < 16; x++) {
+            for (int y = 0; y < 16; y++) {
+                chunk.snapshot.GetFaceMasks(x, y, faceMasks[x * 16 + y]);
+                any |= faceMasks[x * 16 + y][0].words[0];
+            }
+        }
+        Bench::Consume(any);
+    };
+    uint64_t voxelFaces = 0;
+    double bitmask = Bench::BestOf(5, 100, masks);
+    double perVoxel = Bench::BestOf(5, 3, [&]() { voxelFaces = CountFacesPerVoxel(chunk, neighbors); });
+
+    uint64_t maskFaces = 0;
+    for (const ColumnMask(&column)[6] : faceMasks)
+        for (const ColumnMask& faces : column)
+            maskFaces += CountBits(faces);
+    Bench::Report("GetFaceMasks, whole chunk", bitmask * 1e6, "us");
+    Bench::Report("GetBlock per voxel, whole chunk", perVoxel * 1e6, "us");
+    Bench::Report("visible faces, masks", (double)maskFaces, "faces");
+    Bench::Report("visible faces, per voxel", (double)voxelFaces, "faces");
+    if (maskFaces != voxelFaces)
+        std::printf("  MISMATCH, the two culling paths disagree\n");
+    chunk.snapshot.Release();
+}
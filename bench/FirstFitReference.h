@@ -0,0 +1,99 @@
+#pragma once
+#include <map>
+#include <iterator>
+#include <cstdint>
+#include <cstddef>
+
+/// <summary>
+/// The first fit allocator ArenaAllocator replaced, kept only as the baseline of ArenaAllocatorBench.
+/// Free ranges are kept sorted by offset and merged with their neighbors when freed, an allocation takes the first free range that fits.
+/// </summary>
+class FirstFitAllocator {
+public:
+	static constexpr uint32_t InvalidOffset = UINT32_MAX;
+
+	FirstFitAllocator(uint32_t capacity = 0) {
+		Grow(capacity);
+	}
+	/// <summary>
+	/// Offset of a new range of size units, or InvalidOffset if no free range is large enough
+	/// </summary>
+	uint32_t Allocate(uint32_t size) {
+		if (size == 0)
+			return InvalidOffset;
+		for (auto it = _free.begin(); it != _free.end(); ++it) {
+			if (it->second < size)
+				continue;
+			uint32_t offset = it->first;
+			uint32_t remaining = it->second - size;
+			_free.erase(it);
+			if (remaining > 0)
+				_free.emplace(offset + size, remaining);
+			_used += size;
+			return offset;
+		}
+		return InvalidOffset;
+	}
+	/// <summary>
+	/// Returns a range from Allocate, size must be the size it was allocated with
+	/// </summary>
+	void Free(uint32_t offset, uint32_t size) {
+		if (size == 0)
+			return;
+		_used -= size;
+		auto next = _free.lower_bound(offset);
+		if (next != _free.end() && offset + size == next->first) {
+			size += next->second;
+			next = _free.erase(next);
+		}
+		if (next != _free.begin()) {
+			auto previous = std::prev(next);
+			if (previous->first + previous->second == offset) {
+				previous->second += size;
+				return;
+			}
+		}
+		_free.emplace_hint(next, offset, size);
+	}
+	/// <summary>
+	/// Extends the arena to capacity units, the new space is free. Existing ranges keep their offsets.
+	/// </summary>
+	void Grow(uint32_t capacity) {
+		if (capacity <= _capacity)
+			return;
+		uint32_t added = capacity - _capacity;
+		uint32_t start = _capacity;
+		_capacity = capacity;
+		_used += added;
+		Free(start, added);
+	}
+	uint32_t Capacity() const noexcept {
+		return _capacity;
+	}
+	/// <summary>
+	/// Units handed out and not yet freed
+	/// </summary>
+	uint32_t Used() const noexcept {
+		return _used;
+	}
+	/// <summary>
+	/// Size of the largest free range, the largest allocation that can succeed without growing
+	/// </summary>
+	uint32_t LargestFree() const noexcept {
+		uint32_t largest = 0;
+		for (const auto& range : _free)
+			if (range.second > largest)
+				largest = range.second;
+		return largest;
+	}
+	size_t FreeRangeCount() const noexcept {
+		return _free.size();
+	}
+private:
+	/// <summary>
+	/// Free ranges, offset to size. Adjacent free ranges are always merged.
+	/// </summary>
+	std::map<uint32_t, uint32_t> _free;
+	uint32_t _capacity = 0;
+	uint32_t _used = 0;
+};
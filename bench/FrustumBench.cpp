@@ -0,0 +1,64 @@
+#include "Bench.h"
+#include "World/Frustum.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <cmath>
+
+namespace {
+    const int GridSide = 100;
+
+    //IntersectsBox once per box, how ChunkManager culled before the batch
+    void CullEach(const Frustum& frustum, const BoxBatch& boxes, std::vector<uint8_t>& visible) {
+        visible.resize(boxes.Size());
+        for (size_t i = 0; i < boxes.Size(); i++) {
+            glm::vec3 min(boxes.Min(0)[i], boxes.Min(1)[i], boxes.Min(2)[i]);
+            glm::vec3 max(boxes.Max(0)[i], boxes.Max(1)[i], boxes.Max(2)[i]);
+            visible[i] = frustum.IntersectsBox(min, max);
+        }
+    }
+}
+
+BENCHMARK(FrustumCulling) {
+    //10k chunk columns around the player, a render distance of 50 chunks
+    BoxBatch boxes;
+    for (int x = -GridSide / 2; x < GridSide / 2; x++) {
+        for (int y = -GridSide / 2; y < GridSide / 2; y++)
+            boxes.Add(glm::vec3(x * 16.0f, y * 16.0f, 0.0f), glm::vec3(x * 16.0f + 16.0f, y * 16.0f + 16.0f, 256.0f));
+    }
+    //the engine's projection, turning around through eight headings and tilting a little
+    glm::mat4 projection = glm::perspective(glm::radians(70.0f), 1000.0f / 600.0f, 0.1f, 1000.0f);
+    std::vector<Frustum> frusta;
+    for (int heading = 0; heading < 8; heading++) {
+        float yaw = heading * 0.785398f, pitch = (heading % 3 - 1) * 0.3f;
+        glm::vec3 eye(8.0f, 8.0f, 100.0f);
+        glm::vec3 look(std::cos(yaw) * std::cos(pitch), std::sin(yaw) * std::cos(pitch), std::sin(pitch));
+        frusta.push_back(Frustum::FromMatrix(projection * glm::lookAt(eye, eye + look, glm::vec3(0.0f, 0.0f, 1.0f))));
+    }
+
+    std::vector<uint8_t> batch, each;
+    uint64_t visible = 0, mismatches = 0;
+    for (const Frustum& frustum : frusta) {
+        frustum.CullBoxes(boxes, batch);
+        CullEach(frustum, boxes, each);
+        for (size_t i = 0; i < boxes.Size(); i++) {
+            visible += batch[i];
+            mismatches += batch[i] != each[i];
+        }
+    }
+    std::printf("  %zu boxes, %.1f%% visible, %llu disagreements\n", boxes.Size(), 100.0 * visible / (boxes.Size() * frusta.size()), (unsigned long long)mismatches);
+
+    double simd = Bench::BestOf(5, 20, [&]() {
+        for (const Frustum& frustum : frusta) {
+            frustum.CullBoxes(boxes, batch);
+            Bench::Consume(batch[boxes.Size() / 2]);
+        }
+    });
+    double scalar = Bench::BestOf(5, 20, [&]() {
+        for (const Frustum& frustum : frusta) {
+            CullEach(frustum, boxes, each);
+            Bench::Consume(each[boxes.Size() / 2]);
+        }
+    });
+    Bench::Report("CullBoxes", simd / frusta.size() * 1e6, "us/10k boxes");
+    Bench::Report("IntersectsBox per box", scalar / frusta.size() * 1e6, "us/10k boxes");
+    std::printf("  CullBoxes x%.2f\n", scalar / simd);
+}
@@ -0,0 +1,93 @@
+#include "Bench.h"
+#include "ThreadPoolReference.h"
+#include "Thread/JobSystem.h"
+#include <atomic>
+#include <thread>
+
+namespace {
+    const int JobCount = 200000;
+    const int Roots = 64;
+
+    void WaitFor(std::atomic<int>& remaining) {
+        while (remaining.load() > 0)
+            std::this_thread::yield();
+    }
+
+    //a few hundred nanoseconds of arithmetic, about the size of the smallest jobs the engine queues
+    uint64_t Work(uint64_t seed) {
+        for (int i = 0; i < 64; i++)
+            seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        return seed;
+    }
+
+    //Every job queued from the calling thread, like ChunkManager scheduling generation and meshing.
+    //The capture is 32 bytes, past std::function's inline buffer but inside Task's.
+    template<typename Pool>
+    double External(Pool& pool) {
+        std::atomic<int> remaining{ JobCount };
+        std::atomic<uint64_t> sum{ 0 };
+        double start = Bench::Now();
+        for (int i = 0; i < JobCount; i++) {
+            uint64_t seed = i;
+            pool.enqueue([&remaining, &sum, seed, i]() {
+                sum.fetch_add(Work(seed + i), std::memory_order_relaxed);
+                remaining.fetch_sub(1);
+            });
+        }
+        WaitFor(remaining);
+        double seconds = Bench::Now() - start;
+        Bench::Consume(sum.load());
+        return seconds;
+    }
+
+    //A few root jobs that each queue their share of the work from inside the pool
+    template<typename Pool>
+    double FanOut(Pool& pool) {
+        std::atomic<int> remaining{ JobCount };
+        std::atomic<uint64_t> sum{ 0 };
+        double start = Bench::Now();
+        for (int root = 0; root < Roots; root++) {
+            pool.enqueue([&pool, &remaining, &sum, root]() {
+                for (int i = 0; i < JobCount / Roots; i++) {
+                    uint64_t seed = (uint64_t)root * JobCount + i;
+                    pool.enqueue([&remaining, &sum, seed]() {
+                        sum.fetch_add(Work(seed), std::memory_order_relaxed);
+                        remaining.fetch_sub(1);
+                    });
+                }
+            });
+        }
+        WaitFor(remaining);
+        double seconds = Bench::Now() - start;
+        Bench::Consume(sum.load());
+        return seconds;
+    }
+
+    template<typename Pool>
+    void Run(const char* name, size_t threads, double& external, double& fanOut) {
+        Pool pool(threads);
+        external = 1e30;
+        fanOut = 1e30;
+        for (int run = 0; run < 3; run++) {
+            external = std::min(external, External(pool));
+            fanOut = std::min(fanOut, FanOut(pool));
+        }
+        char label[64];
+        std::snprintf(label, sizeof(label), "%s, %zu threads, queued outside", name, threads);
+        Bench::Report(label, JobCount / external / 1e6, "M jobs/s");
+        std::snprintf(label, sizeof(label), "%s, %zu threads, fan out", name, threads);
+        Bench::Report(label, JobCount / fanOut / 1e6, "M jobs/s");
+    }
+}
+
+static_assert(JobCount % Roots == 0, "FanOut splits the jobs evenly between the roots");
+
+BENCHMARK(JobSystemThroughput) {
+    std::printf("  %d jobs per run, %u hardware threads\n", JobCount, std::thread::hardware_concurrency());
+    for (size_t threads = 1; threads <= 32; threads *= 2) {
+        double poolExternal, poolFanOut, jobsExternal, jobsFanOut;
+        Run<ThreadPool>("ThreadPool", threads, poolExternal, poolFanOut);
+        Run<JobSystem>("JobSystem", threads, jobsExternal, jobsFanOut);
+        std::printf("  %zu threads: JobSystem x%.2f queued outside, x%.2f fan out\n", threads, poolExternal / jobsExternal, poolFanOut / jobsFanOut);
+    }
+}
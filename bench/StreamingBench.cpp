@@ -0,0 +1,71 @@
+#include "Bench.h"
+#include "World/Chunk.h"
+#include "Thread/JobSystem.h"
+#include <memory>
+#include <thread>
+
+namespace {
+    const int Side = 16;
+    const int ChunkCount = Side * Side;
+
+    void WaitFor(std::atomic<int>& remaining) {
+        while (remaining.load() > 0)
+            std::this_thread::yield();
+    }
+
+    //Loads a Side x Side square the way ChunkManager does: generation jobs, snapshots on the calling thread once they're done, then mesh jobs.
+    //Returns seconds for the whole square.
+    double LoadSquare(JobSystem& workers, Chunk* chunks, StagingRing& ring, int origin) {
+        double start = Bench::Now();
+        std::atomic<int> remaining{ ChunkCount };
+        for (int i = 0; i < ChunkCount; i++) {
+            chunks[i].Reset();
+            chunks[i].position = glm::vec2(origin + i % Side, i / Side);
+            workers.enqueue([&chunks, &remaining, i]() {
+                chunks[i].Generate();
+                remaining.fetch_sub(1);
+            });
+        }
+        WaitFor(remaining);
+        auto at = [&](int x, int y) -> const Chunk* {
+            return x >= 0 && x < Side && y >= 0 && y < Side ? &chunks[y * Side + x] : nullptr;
+        };
+        remaining.store(ChunkCount);
+        for (int i = 0; i < ChunkCount; i++) {
+            int x = i % Side, y = i / Side;
+            chunks[i].TakeSnapshot(at(x, y + 1), at(x + 1, y), at(x, y - 1), at(x - 1, y));
+            workers.enqueue([&chunks, &ring, &remaining, i]() {
+                chunks[i].BuildMesh(ring, MeshingMode::Greedy);
+                remaining.fetch_sub(1);
+            });
+        }
+        WaitFor(remaining);
+        double seconds = Bench::Now() - start;
+        for (int i = 0; i < ChunkCount; i++)
+            chunks[i].ReleaseStaging(ring);
+        ring.Submit();
+        ring.Retire();
+        return seconds;
+    }
+}
+
+BENCHMARK(StreamingScaling) {
+    std::unique_ptr<Chunk[]> chunks(new Chunk[ChunkCount]);
+    StagingRing ring(std::make_unique<NullStagingBackend>());
+    ring.Create(64 << 20);
+    size_t hardware = std::max(1u, std::thread::hardware_concurrency());
+    std::printf("  %d chunks generated and greedy meshed, %zu hardware threads\n", ChunkCount, hardware);
+    double single = 0.0;
+    for (size_t threads = 1; threads <= std::max<size_t>(hardware, 16); threads *= 2) {
+        JobSystem workers(threads);
+        double best = 1e30;
+        //a new square every run, so no run is served from chunks generated by the last
+        for (int run = 0; run < 3; run++)
+            best = std::min(best, LoadSquare(workers, chunks.get(), ring, run * Side * 2));
+        if (threads == 1)
+            single = best;
+        char label[64];
+        std::snprintf(label, sizeof(label), "%zu threads (x%.2f)", threads, single / best);
+        Bench::Report(label, ChunkCount / best, "chunks/s");
+    }
+}
@@ -7,6 +7,9 @@
 #include <condition_variable>
 #include <functional>
 
+/// <summary>
+/// The pool JobSystem replaced, kept only as the baseline of JobSystemBench: one std::queue of std::function behind one mutex and condition variable.
+/// </summary>
 class ThreadPool {
 public:
     ThreadPool(size_t count = std::thread::hardware_concurrency()) {
@@ -57,4 +60,4 @@ private:
     std::mutex mtx;
     std::condition_variable cv;
     bool stop = false;
-};
\ No newline at end of file
+};
@@ -4,7 +4,8 @@ out vec4 FragColor;
 
 in vec3 FragPos;
 in vec3 Normal;
-in vec2 TexCoord;
+in vec2 TileUV;
+flat in vec2 TileOrigin;
 
 uniform vec3 CameraPos;
 uniform sampler2D TextureAtlas;
@@ -17,8 +18,13 @@ void main()
     //vec2 uv = TexCoord;
     //float pad = 1.0 / 256.0;  // e.g. 1 / 256
     //uv = uv * (1.0 - 2.0 * pad) + pad;
+    //wrap into the atlas tile, 0.0001 padding to prevent texture bleeding on mipmaps
+    vec2 texCoord = TileOrigin + vec2(0.0001) + fract(TileUV) * (0.0625 - 0.0002);
+    //gradients from the unwrapped coordinates, fract would otherwise jump at every block edge and pick the smallest mip
+    vec2 dx = dFdx(TileUV) * 0.0625;
+    vec2 dy = dFdy(TileUV) * 0.0625;
     float distanceToPlayer = distance(CameraPos, FragPos);
     float brightness = max(dot(normalize(globalLightDirection), normalize(Normal)), dot(normalize(globalLightOpposite), normalize(Normal)) * 0.7);
     float fade = 1 - max(0, (distanceToPlayer - fadeStartDistance) / 10);
-    FragColor = vec4(texture(TextureAtlas, TexCoord).rgb * brightness, 1.0) * fade;
+    FragColor = vec4(textureGrad(TextureAtlas, texCoord, dx, dy).rgb * brightness, 1.0) * fade;
 }
\ No newline at end of file
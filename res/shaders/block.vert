@@ -1,16 +1,17 @@
 ﻿#version 460 core
-layout (location = 0) in vec3 aPos;
-layout (location = 1) in uint faceIndex;
-layout (location = 2) in uint texIndex;
-layout (location = 3) in uint blockID;
+//Packed vertex, see Vertex.h
+//bits 0-4 x, 5-9 y, 10-18 z, 19-21 face, 22-23 corner, 24-31 block ID
+layout (location = 0) in uint aData;
+//Chunk position, one per chunk drawn, see DrawCommands.h
+layout (location = 1) in ivec2 aChunk;
 
 out vec3 FragPos;
-out vec2 TexCoord;
+out vec2 TileUV;
+flat out vec2 TileOrigin;
 out vec3 Normal;
 
 uniform mat4 projection;
 uniform mat4 view;
-uniform mat4 model;
 
 const vec3 faceNormals[6] = vec3[](
     vec3( 0.0,  1.0,  0.0), // +Y → Front face
@@ -21,14 +22,23 @@ const vec3 faceNormals[6] = vec3[](
     vec3( 0.0,  0.0,  1.0)  // +Z → Top face
 );
 
-//0.0001 padding to prevent texture bleeding on mipmaps
-const vec2 texCoords[6] = vec2[](
-    vec2(0.0001, 1.0 - 0.0625 + 0.0001),
-    vec2(0.0625 - 0.0001, 1.0 - 0.0625 + 0.0001),
-    vec2(0.0001, 1.0 - 0.0001),
-    vec2(0.0001, 1.0 - 0.0001),
-    vec2(0.0625 - 0.0001, 1.0 - 0.0625 + 0.0001),
-    vec2(0.0625 - 0.0001, 1.0 - 0.0001)
+//Texture u and v directions of each face in block space
+//Texture coordinates are taken from the vertex position, so a merged quad repeats the tile once per block
+const vec3 faceU[6] = vec3[](
+    vec3( 1.0,  0.0,  0.0),
+    vec3(-1.0,  0.0,  0.0),
+    vec3( 0.0,  1.0,  0.0),
+    vec3( 0.0, -1.0,  0.0),
+    vec3( 1.0,  0.0,  0.0),
+    vec3( 1.0,  0.0,  0.0)
+);
+const vec3 faceV[6] = vec3[](
+    vec3( 0.0,  0.0,  1.0),
+    vec3( 0.0,  0.0,  1.0),
+    vec3( 0.0,  0.0,  1.0),
+    vec3( 0.0,  0.0,  1.0),
+    vec3( 0.0,  1.0,  0.0),
+    vec3( 0.0, -1.0,  0.0)
 );
 
 const vec3 blockCoords[3] = vec3[](
@@ -44,8 +54,12 @@ const vec3 blockCoords[3] = vec3[](
 //Texture coords - Bottom-left -> top-right
 void main()
 {
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
-	FragPos = vec3(model * vec4(aPos, 1.0));
+    vec3 aPos = vec3(aData & 31u, (aData >> 5) & 31u, (aData >> 10) & 511u);
+    uint faceIndex = (aData >> 19) & 7u;
+    uint blockID = aData >> 24;
+    vec3 worldPos = aPos + vec3(aChunk * 16, 0.0);
+    gl_Position = projection * view * vec4(worldPos, 1.0);
+	FragPos = worldPos;
 	Normal = faceNormals[faceIndex];
 
     int index = 0;
@@ -54,5 +68,6 @@ void main()
     else if (abs(Normal.x) + abs(Normal.y) > 0)
         index = 1;
     //TODO: modulation for y axis for blockids that are greater or equal to 16, every 16 blocks, add 0.0625 to y
-    TexCoord = texCoords[texIndex] + vec2(0.0625 * blockCoords[blockID - 1][index], 0.0);
+    TileOrigin = vec2(0.0625 * blockCoords[blockID - 1][index], 1.0 - 0.0625);
+    TileUV = vec2(dot(aPos, faceU[faceIndex]), dot(aPos, faceV[faceIndex]));
 }  
\ No newline at end of file
@@ -38,6 +38,12 @@ public:
 	glm::mat4 GetView() {
 		return _camera->GetViewMatrix();
 	}
+	const glm::vec3& GetFront() {
+		return _camera->Front;
+	}
+	const glm::vec3& GetCameraPosition() {
+		return _camera->Position;
+	}
 	void Update(double delta) override;
 	void ApplyMovement(const glm::vec2& direction, float maxSpeed, double delta);
 	void ApplyGravity(float maxFallSpeed, float gravity, double delta);
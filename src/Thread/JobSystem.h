@@ -0,0 +1,267 @@
+#pragma once
+
+#include <thread>
+#include <vector>
+#include <queue>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <condition_variable>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/// <summary>
+/// Move only callable with inline storage for small captures, so enqueueing a typical job doesn't allocate.
+/// Callables larger than InlineSize fall back to the heap.
+/// </summary>
+class Task {
+public:
+    static constexpr size_t InlineSize = 48;
+
+    Task() = default;
+    template<typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, Task>>>
+    Task(F&& f) {
+        using Fn = std::decay_t<F>;
+        if constexpr (sizeof(Fn) <= InlineSize && alignof(Fn) <= alignof(std::max_align_t) && std::is_nothrow_move_constructible_v<Fn>) {
+            new (_storage) Fn(std::forward<F>(f));
+            _ops = &InlineOps<Fn>;
+        }
+        else {
+            *reinterpret_cast<Fn**>(_storage) = new Fn(std::forward<F>(f));
+            _ops = &HeapOps<Fn>;
+        }
+    }
+    Task(Task&& other) noexcept {
+        MoveFrom(other);
+    }
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            Reset();
+            MoveFrom(other);
+        }
+        return *this;
+    }
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    ~Task() {
+        Reset();
+    }
+
+    explicit operator bool() const {
+        return _ops != nullptr;
+    }
+    void operator()() {
+        _ops->invoke(_storage);
+    }
+
+private:
+    struct Ops {
+        void (*invoke)(void* storage);
+        void (*move)(void* destination, void* source);
+        void (*destroy)(void* storage);
+    };
+    template<typename Fn>
+    static inline const Ops InlineOps = {
+        [](void* storage) { (*static_cast<Fn*>(storage))(); },
+        [](void* destination, void* source) {
+            new (destination) Fn(std::move(*static_cast<Fn*>(source)));
+            static_cast<Fn*>(source)->~Fn();
+        },
+        [](void* storage) { static_cast<Fn*>(storage)->~Fn(); }
+    };
+    template<typename Fn>
+    static inline const Ops HeapOps = {
+        [](void* storage) { (**static_cast<Fn**>(storage))(); },
+        [](void* destination, void* source) { *static_cast<Fn**>(destination) = *static_cast<Fn**>(source); },
+        [](void* storage) { delete *static_cast<Fn**>(storage); }
+    };
+
+    alignas(std::max_align_t) unsigned char _storage[InlineSize];
+    const Ops* _ops = nullptr;
+
+    void MoveFrom(Task& other) noexcept {
+        _ops = other._ops;
+        if (_ops)
+            _ops->move(_storage, other._storage);
+        other._ops = nullptr;
+    }
+    void Reset() {
+        if (_ops)
+            _ops->destroy(_storage);
+        _ops = nullptr;
+    }
+};
+
+/// <summary>
+/// Work stealing job system, a drop in replacement for the old single queue ThreadPool.
+/// Every worker owns a deque. Jobs enqueued from a worker go to its own deque, jobs from other threads are spread round robin.
+/// Owners take from the front so jobs run roughly in submission order, idle workers steal from the back of the other
+/// deques before going to sleep. Each deque has its own lock, the only shared lock is the one idle workers sleep on.
+/// Like ThreadPool, join discards the jobs that haven't started.
+/// </summary>
+class JobSystem {
+public:
+    JobSystem(size_t count = std::thread::hardware_concurrency()) {
+        if (count == 0)
+            count = 1;
+        for (size_t i = 0; i < count; ++i)
+            queues.emplace_back(std::make_unique<WorkerQueue>());
+        for (size_t i = 0; i < count; ++i) {
+            workers.emplace_back([this, i] {
+                currentSystem = this;
+                currentWorker = i;
+                for (;;) {
+                    if (stop.load())
+                        return;
+                    Task job;
+                    if (TryPop(i, job) || TrySteal(i, job)) {
+                        pending.fetch_sub(1);
+                        job(); // execute
+                        continue;
+                    }
+                    std::unique_lock<std::mutex> lock(sleepMutex);
+                    sleepers.fetch_add(1);
+                    cv.wait(lock, [this] {
+                        return pending.load() > 0 || stop;
+                    });
+                    sleepers.fetch_sub(1);
+                    if (stop)
+                        return;
+                }
+            });
+        }
+    }
+
+    /// <summary>
+    /// Waits for the jobs that are running to finish and stops the workers. Jobs still queued are destroyed without running.
+    /// </summary>
+    void join() {
+        {
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            stop = true;
+        }
+        cv.notify_all();
+        for (auto& t : workers) t.join();
+        workers.clear();
+        //the workers are gone, so the captures of the jobs left behind are released here rather than with the pool
+        for (auto& queue : queues)
+            queue->jobs = TaskRing();
+        pending = 0;
+    }
+    ~JobSystem() {
+        join();
+    }
+
+    template<typename F>
+    void enqueue(F&& job) {
+        size_t index = currentSystem == this ? currentWorker : nextQueue.fetch_add(1) % queues.size();
+        //counted before it is visible so a worker can never take it first and drive pending negative
+        pending.fetch_add(1);
+        {
+            WorkerQueue& queue = *queues[index];
+            std::lock_guard<std::mutex> lock(queue.mtx);
+            queue.jobs.push_back(Task(std::forward<F>(job)));
+        }
+        //A worker registers as a sleeper before checking pending under sleepMutex,
+        //so either it sees this job or this sees it sleeping
+        if (sleepers.load() > 0) {
+            { std::lock_guard<std::mutex> lock(sleepMutex); }
+            cv.notify_one();
+        }
+    }
+
+    size_t size() const {
+        return queues.size();
+    }
+
+private:
+    /// <summary>
+    /// Growable ring buffer of tasks. Unlike std::deque it keeps its storage, so a steady stream of jobs doesn't allocate.
+    /// </summary>
+    struct TaskRing {
+        std::vector<Task> slots;
+        size_t head = 0;
+        size_t count = 0;
+
+        bool empty() const {
+            return count == 0;
+        }
+        void push_back(Task&& task) {
+            if (count == slots.size())
+                Grow();
+            slots[(head + count) & (slots.size() - 1)] = std::move(task);
+            count++;
+        }
+        Task pop_front() {
+            Task task = std::move(slots[head]);
+            head = (head + 1) & (slots.size() - 1);
+            count--;
+            return task;
+        }
+        Task pop_back() {
+            count--;
+            return std::move(slots[(head + count) & (slots.size() - 1)]);
+        }
+        void Grow() {
+            std::vector<Task> grown(slots.empty() ? 16 : slots.size() * 2);
+            for (size_t i = 0; i < count; i++)
+                grown[i] = std::move(slots[(head + i) & (slots.size() - 1)]);
+            slots.swap(grown);
+            head = 0;
+        }
+    };
+    struct WorkerQueue {
+        std::mutex mtx;
+        TaskRing jobs;
+    };
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::atomic<size_t> nextQueue{ 0 };
+    std::atomic<int> pending{ 0 };
+    std::atomic<int> sleepers{ 0 };
+    std::mutex sleepMutex;
+    std::condition_variable cv;
+    std::atomic<bool> stop{ false };
+    static inline thread_local JobSystem* currentSystem = nullptr;
+    static inline thread_local size_t currentWorker = 0;
+
+    bool TryPop(size_t index, Task& job) {
+        WorkerQueue& queue = *queues[index];
+        std::lock_guard<std::mutex> lock(queue.mtx);
+        if (queue.jobs.empty())
+            return false;
+        job = queue.jobs.pop_front();
+        return true;
+    }
+
+    bool TrySteal(size_t thief, Task& job) {
+        bool contended = false;
+        for (size_t i = 1; i < queues.size(); ++i) {
+            WorkerQueue& queue = *queues[(thief + i) % queues.size()];
+            std::unique_lock<std::mutex> lock(queue.mtx, std::try_to_lock);
+            if (!lock.owns_lock()) {
+                contended = true;
+                continue;
+            }
+            if (queue.jobs.empty())
+                continue;
+            job = queue.jobs.pop_back();
+            return true;
+        }
+        if (!contended)
+            return false;
+        //A busy queue may be holding the job pending counts, and the sleep wait returns at once while pending is above 0.
+        //Waiting for the locks on a second pass keeps the worker from spinning on try_lock until the owner lets go
+        for (size_t i = 1; i < queues.size(); ++i) {
+            WorkerQueue& queue = *queues[(thief + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(queue.mtx);
+            if (queue.jobs.empty())
+                continue;
+            job = queue.jobs.pop_back();
+            return true;
+        }
+        return false;
+    }
+};
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+/// <summary>
+/// Bounded lock free queue for many producer threads and a single consumer thread.
+/// Each cell carries a sequence number that tells producers and the consumer whose turn it is,
+/// so pushing is one compare exchange on the tail and popping touches no shared counter at all.
+/// Capacity is rounded up to a power of two. TryPush fails instead of blocking when the queue is full.
+/// </summary>
+template<typename T>
+class MPSCQueue {
+public:
+    explicit MPSCQueue(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity)
+            size <<= 1;
+        _cells = std::make_unique<Cell[]>(size);
+        _mask = size - 1;
+        for (size_t i = 0; i < size; i++)
+            _cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    MPSCQueue(const MPSCQueue&) = delete;
+    MPSCQueue& operator=(const MPSCQueue&) = delete;
+
+    /// <summary>
+    /// Safe from any thread. Returns false, leaving value untouched, if the queue is full.
+    /// </summary>
+    bool TryPush(T&& value) {
+        Cell* cell;
+        size_t position = _tail.load(std::memory_order_relaxed);
+        for (;;) {
+            cell = &_cells[position & _mask];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+            //the cell is free for this position, claim it
+            if (difference == 0) {
+                if (_tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    break;
+            }
+            //the consumer hasn't emptied this cell since the last lap
+            else if (difference < 0)
+                return false;
+            //another producer claimed the position first
+            else
+                position = _tail.load(std::memory_order_relaxed);
+        }
+        cell->value = std::move(value);
+        cell->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// <summary>
+    /// Consumer thread only. Returns false if the queue is empty.
+    /// </summary>
+    bool TryPop(T& value) {
+        Cell& cell = _cells[_head & _mask];
+        size_t sequence = cell.sequence.load(std::memory_order_acquire);
+        //not published yet
+        if ((intptr_t)sequence - (intptr_t)(_head + 1) < 0)
+            return false;
+        value = std::move(cell.value);
+        //hand the cell back to producers for their next lap
+        cell.sequence.store(_head + _mask + 1, std::memory_order_release);
+        _head++;
+        return true;
+    }
+
+    size_t Capacity() const {
+        return _mask + 1;
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence{ 0 };
+        T value{};
+    };
+    std::unique_ptr<Cell[]> _cells;
+    size_t _mask = 0;
+    //producers and the consumer each get their own cache line
+    alignas(64) std::atomic<size_t> _tail{ 0 };
+    alignas(64) size_t _head = 0;
+};
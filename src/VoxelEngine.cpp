@@ -132,6 +132,7 @@ int main()
     //initialize UI manager with gpu
     uiManager->Initialize(viewportWidth, viewportHeight);
     uiManager->AddUIComponent(crosshairComponent);
+    chunkManager->Initialize();
     
     //main window loop
     std::cout << glm::to_string(UIProjection);
@@ -151,7 +152,7 @@ int main()
         blockShader.setMat4("view", player->GetView());
         blockShader.setVec3("CameraPos", player->GetPosition());
         blockShader.setFloat("fadeStartDistance", chunkManager->RenderDistance * 16 - 20);
-        chunkManager->Update(blockShader);
+        chunkManager->Update(blockShader, Projection);
 
         //Update and render UI
         uiShader.use();
@@ -0,0 +1,294 @@
+#include "World/ArenaAllocator.h"
+#include "World/ColumnMask.h"
+#include <algorithm>
+
+ArenaAllocator::ArenaAllocator(uint32_t capacity) {
+    for (auto& bins : _bins)
+        std::fill(std::begin(bins), std::end(bins), Null);
+    Grow(capacity);
+}
+
+void ArenaAllocator::Mapping(uint32_t size, int& sizeClass, int& bin) noexcept {
+    if (size < SubdivisionCount) {
+        sizeClass = 0;
+        bin = (int)size;
+        return;
+    }
+    int power = HighestSetBit(size);
+    sizeClass = power - SubdivisionBits + 1;
+    bin = (int)(size >> (power - SubdivisionBits)) - SubdivisionCount;
+}
+
+uint32_t ArenaAllocator::FindFree(uint32_t size) const noexcept {
+    //Rounded up to the next bin, every block in that bin or above fits without walking a list
+    uint32_t rounded = size;
+    if (size >= SubdivisionCount)
+        rounded += (1u << (HighestSetBit(size) - SubdivisionBits)) - 1;
+    int sizeClass, bin;
+    Mapping(rounded, sizeClass, bin);
+    uint32_t bins = sizeClass < ClassCount ? _binBitmaps[sizeClass] & (~0u << bin) : 0;
+    if (bins == 0) {
+        uint32_t classes = sizeClass + 1 < ClassCount ? _classBitmap & (~0u << (sizeClass + 1)) : 0;
+        if (classes != 0) {
+            sizeClass = LowestSetBit(classes);
+            bins = _binBitmaps[sizeClass];
+        }
+    }
+    if (bins != 0)
+        return _bins[sizeClass][LowestSetBit(bins)];
+    //the rounding skipped size's own bin, which can still hold a block large enough
+    Mapping(size, sizeClass, bin);
+    for (uint32_t block = _bins[sizeClass][bin]; block != Null; block = _blocks[block].nextFree)
+        if (_blocks[block].size >= size)
+            return block;
+    return Null;
+}
+
+void ArenaAllocator::InsertFree(uint32_t block) {
+    int sizeClass, bin;
+    Mapping(_blocks[block].size, sizeClass, bin);
+    uint32_t head = _bins[sizeClass][bin];
+    _blocks[block].free = true;
+    _blocks[block].previousFree = Null;
+    _blocks[block].nextFree = head;
+    if (head != Null)
+        _blocks[head].previousFree = block;
+    _bins[sizeClass][bin] = block;
+    _binBitmaps[sizeClass] |= 1u << bin;
+    _classBitmap |= 1u << sizeClass;
+}
+
+void ArenaAllocator::RemoveFree(uint32_t block) {
+    Block& removed = _blocks[block];
+    if (removed.previousFree != Null)
+        _blocks[removed.previousFree].nextFree = removed.nextFree;
+    if (removed.nextFree != Null)
+        _blocks[removed.nextFree].previousFree = removed.previousFree;
+    int sizeClass, bin;
+    Mapping(removed.size, sizeClass, bin);
+    if (_bins[sizeClass][bin] == block) {
+        _bins[sizeClass][bin] = removed.nextFree;
+        if (removed.nextFree == Null) {
+            _binBitmaps[sizeClass] &= ~(1u << bin);
+            if (_binBitmaps[sizeClass] == 0)
+                _classBitmap &= ~(1u << sizeClass);
+        }
+    }
+    removed.free = false;
+    removed.previousFree = Null;
+    removed.nextFree = Null;
+}
+
+uint32_t ArenaAllocator::NewBlock() {
+    if (!_unusedBlocks.empty()) {
+        uint32_t block = _unusedBlocks.back();
+        _unusedBlocks.pop_back();
+        _blocks[block] = Block();
+        return block;
+    }
+    _blocks.emplace_back();
+    return (uint32_t)_blocks.size() - 1;
+}
+
+uint32_t ArenaAllocator::Split(uint32_t block, uint32_t size) {
+    uint32_t rest = NewBlock();
+    Block& front = _blocks[block];
+    Block& back = _blocks[rest];
+    back.offset = front.offset + size;
+    back.size = front.size - size;
+    back.previous = block;
+    back.next = front.next;
+    front.size = size;
+    front.next = rest;
+    if (back.next != Null)
+        _blocks[back.next].previous = rest;
+    else
+        _last = rest;
+    return rest;
+}
+
+void ArenaAllocator::Unlink(uint32_t block) {
+    Block& removed = _blocks[block];
+    if (removed.previous != Null)
+        _blocks[removed.previous].next = removed.next;
+    else
+        _first = removed.next;
+    if (removed.next != Null)
+        _blocks[removed.next].previous = removed.previous;
+    else
+        _last = removed.previous;
+    _unusedBlocks.push_back(block);
+}
+
+void ArenaAllocator::Release(uint32_t block) {
+    _blocks[block].handle = Null;
+    uint32_t previous = _blocks[block].previous;
+    if (previous != Null && _blocks[previous].free) {
+        RemoveFree(previous);
+        _blocks[previous].size += _blocks[block].size;
+        Unlink(block);
+        block = previous;
+    }
+    uint32_t next = _blocks[block].next;
+    if (next != Null && _blocks[next].free) {
+        RemoveFree(next);
+        _blocks[block].size += _blocks[next].size;
+        Unlink(next);
+    }
+    InsertFree(block);
+}
+
+uint32_t ArenaAllocator::Allocate(uint32_t size) {
+    if (size == 0)
+        return InvalidHandle;
+    uint32_t block = FindFree(size);
+    if (block == Null)
+        return InvalidHandle;
+    RemoveFree(block);
+    if (_blocks[block].size > size)
+        InsertFree(Split(block, size));
+
+    uint32_t handle;
+    if (!_unusedHandles.empty()) {
+        handle = _unusedHandles.back();
+        _unusedHandles.pop_back();
+    }
+    else {
+        handle = (uint32_t)_handles.size();
+        _handles.push_back(Null);
+    }
+    _handles[handle] = block;
+    _blocks[block].handle = handle;
+    _used += size;
+    _allocations++;
+    return handle;
+}
+
+void ArenaAllocator::Free(uint32_t handle) {
+    uint32_t block = _handles[handle];
+    _handles[handle] = Null;
+    _unusedHandles.push_back(handle);
+    _used -= _blocks[block].size;
+    _allocations--;
+    Release(block);
+}
+
+void ArenaAllocator::Grow(uint32_t capacity) {
+    if (capacity <= _capacity)
+        return;
+    uint32_t added = capacity - _capacity;
+    if (_last != Null && _blocks[_last].free) {
+        RemoveFree(_last);
+        _blocks[_last].size += added;
+        InsertFree(_last);
+    }
+    else {
+        uint32_t block = NewBlock();
+        _blocks[block].offset = _capacity;
+        _blocks[block].size = added;
+        _blocks[block].previous = _last;
+        if (_last != Null)
+            _blocks[_last].next = block;
+        else
+            _first = block;
+        _last = block;
+        InsertFree(block);
+    }
+    _capacity = capacity;
+}
+
+uint32_t ArenaAllocator::Compact(uint32_t maxSize, std::vector<Move>& moves) {
+    uint32_t moved = 0;
+    uint32_t hole = _first;
+    while (moved < maxSize) {
+        //the lowest free range, once it's the last block everything is packed
+        while (hole != Null && !_blocks[hole].free)
+            hole = _blocks[hole].next;
+        if (hole == Null || hole == _last)
+            break;
+        //Fill the hole with the highest allocation that fits in it, which lowers the top of the arena.
+        //If none fits, slide the allocation right after it down over it, which moves the hole up
+        uint32_t block = _last;
+        while (block != hole && (_blocks[block].free || _blocks[block].size > _blocks[hole].size))
+            block = _blocks[block].previous;
+        if (block == hole)
+            block = _blocks[hole].next;
+        uint32_t handle = _blocks[block].handle;
+        uint32_t size = _blocks[block].size;
+        moves.push_back({ handle, _blocks[block].offset, _blocks[hole].offset, size });
+        moved += size;
+        RemoveFree(hole);
+        if (block == _blocks[hole].next) {
+            //swap the two blocks' places in the address order, then merge the hole with whatever is free after it
+            uint32_t before = _blocks[hole].previous;
+            uint32_t after = _blocks[block].next;
+            _blocks[block].offset = _blocks[hole].offset;
+            _blocks[hole].offset = _blocks[block].offset + size;
+            _blocks[block].previous = before;
+            _blocks[block].next = hole;
+            _blocks[hole].previous = block;
+            _blocks[hole].next = after;
+            if (before != Null)
+                _blocks[before].next = block;
+            else
+                _first = block;
+            if (after != Null)
+                _blocks[after].previous = hole;
+            else
+                _last = hole;
+            uint32_t next = _blocks[hole].next;
+            if (next != Null && _blocks[next].free) {
+                RemoveFree(next);
+                _blocks[hole].size += _blocks[next].size;
+                Unlink(next);
+            }
+            InsertFree(hole);
+            continue;
+        }
+        //the hole takes the allocation, what's left of it stays free and is the new lowest hole
+        uint32_t target = hole;
+        hole = Null;
+        if (_blocks[target].size > size) {
+            hole = Split(target, size);
+            InsertFree(hole);
+        }
+        _blocks[target].handle = handle;
+        _handles[handle] = target;
+        Release(block);
+        if (hole == Null)
+            hole = target;
+    }
+    return moved;
+}
+
+uint32_t ArenaAllocator::LargestFree() const noexcept {
+    if (_classBitmap == 0)
+        return 0;
+    int sizeClass = HighestSetBit(_classBitmap);
+    uint32_t largest = 0;
+    for (uint32_t block = _bins[sizeClass][HighestSetBit(_binBitmaps[sizeClass])]; block != Null; block = _blocks[block].nextFree)
+        largest = std::max(largest, _blocks[block].size);
+    return largest;
+}
+
+float ArenaAllocator::Fragmentation() const noexcept {
+    uint32_t freeSize = _capacity - _used;
+    return freeSize == 0 ? 0.0f : 1.0f - (float)LargestFree() / (float)freeSize;
+}
+
+ArenaAllocator::Stats ArenaAllocator::GetStats() const {
+    Stats stats;
+    stats.capacity = _capacity;
+    stats.used = _used;
+    stats.allocations = _allocations;
+    for (uint32_t block = _first; block != Null; block = _blocks[block].next) {
+        const Block& range = _blocks[block];
+        if (range.free) {
+            stats.freeRanges++;
+            stats.largestFree = std::max(stats.largestFree, range.size);
+        }
+        else
+            stats.top = range.offset + range.size;
+    }
+    return stats;
+}
@@ -0,0 +1,151 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/// <summary>
+/// Hands out ranges of a fixed size arena, in whatever unit the caller counts in. Doesn't touch the memory itself,
+/// so the arena can be a GL buffer.
+/// Two level segregated fit (TLSF): free ranges are binned by the power of two of their size and 16 steps within it,
+/// with a bitmap of the non empty bins, so allocate and free are a couple of bit scans and list links.
+/// Freed ranges merge with free neighbors right away.
+/// Allocations are referred to by handle, compaction can move a range without its owner having to follow it.
+/// </summary>
+class ArenaAllocator {
+public:
+	static constexpr uint32_t InvalidHandle = UINT32_MAX;
+
+	/// <summary>
+	/// A range Compact moved, to be replayed on the memory in order as a copy of size units from from to to.
+	/// to is always below from. The ranges overlap when an allocation slid down by less than its size.
+	/// </summary>
+	struct Move {
+		uint32_t handle;
+		uint32_t from;
+		uint32_t to;
+		uint32_t size;
+	};
+	struct Stats {
+		uint32_t capacity = 0;
+		/// <summary>
+		/// Units handed out and not yet freed
+		/// </summary>
+		uint32_t used = 0;
+		/// <summary>
+		/// Size of the largest free range, the largest allocation that can succeed without growing
+		/// </summary>
+		uint32_t largestFree = 0;
+		/// <summary>
+		/// End of the highest allocation, everything past it is free
+		/// </summary>
+		uint32_t top = 0;
+		uint32_t freeRanges = 0;
+		uint32_t allocations = 0;
+		/// <summary>
+		/// 0 when all free space is one range, approaching 1 as it splits into many small ones
+		/// </summary>
+		float Fragmentation() const noexcept {
+			uint32_t freeSize = capacity - used;
+			return freeSize == 0 ? 0.0f : 1.0f - (float)largestFree / (float)freeSize;
+		}
+	};
+
+	ArenaAllocator(uint32_t capacity = 0);
+	/// <summary>
+	/// Handle of a new range of size units, or InvalidHandle if no free range is large enough
+	/// </summary>
+	uint32_t Allocate(uint32_t size);
+	void Free(uint32_t handle);
+	inline uint32_t Offset(uint32_t handle) const noexcept {
+		return _blocks[_handles[handle]].offset;
+	}
+	inline uint32_t Size(uint32_t handle) const noexcept {
+		return _blocks[_handles[handle]].size;
+	}
+	/// <summary>
+	/// Extends the arena to capacity units, the new space is free. Existing ranges keep their offsets.
+	/// </summary>
+	void Grow(uint32_t capacity);
+	/// <summary>
+	/// Closes free ranges from the bottom of the arena up, until at least maxSize units have moved or all free space is at the end.
+	/// Each hole is filled with the highest allocation that fits in it, or if none does, the allocation after it slides down.
+	/// Appends the moves made and returns the units moved.
+	/// </summary>
+	uint32_t Compact(uint32_t maxSize, std::vector<Move>& moves);
+	uint32_t Capacity() const noexcept {
+		return _capacity;
+	}
+	uint32_t Used() const noexcept {
+		return _used;
+	}
+	/// <summary>
+	/// Size of the largest free range, found from the bitmaps and the highest non empty bin's list
+	/// </summary>
+	uint32_t LargestFree() const noexcept;
+	/// <summary>
+	/// Same as GetStats().Fragmentation() without walking every block, cheap enough to check each frame
+	/// </summary>
+	float Fragmentation() const noexcept;
+	/// <summary>
+	/// Walks every block
+	/// </summary>
+	Stats GetStats() const;
+private:
+	static constexpr uint32_t Null = UINT32_MAX;
+	/// <summary>
+	/// Each power of two size class is split into 2^SubdivisionBits bins. Sizes below SubdivisionCount get a bin each.
+	/// </summary>
+	static constexpr int SubdivisionBits = 4;
+	static constexpr int SubdivisionCount = 1 << SubdivisionBits;
+	static constexpr int ClassCount = 32 - SubdivisionBits + 1;
+
+	/// <summary>
+	/// A free or allocated range. Blocks are linked in address order, free blocks also into their bin's list.
+	/// </summary>
+	struct Block {
+		uint32_t offset = 0;
+		uint32_t size = 0;
+		uint32_t previous = Null;
+		uint32_t next = Null;
+		uint32_t previousFree = Null;
+		uint32_t nextFree = Null;
+		/// <summary>
+		/// Handle pointing at an allocated block, Null for a free one
+		/// </summary>
+		uint32_t handle = Null;
+		bool free = false;
+	};
+	std::vector<Block> _blocks;
+	std::vector<uint32_t> _unusedBlocks;
+	/// <summary>
+	/// Block of each handle
+	/// </summary>
+	std::vector<uint32_t> _handles;
+	std::vector<uint32_t> _unusedHandles;
+	uint32_t _bins[ClassCount][SubdivisionCount];
+	uint32_t _classBitmap = 0;
+	uint32_t _binBitmaps[ClassCount] = {};
+	uint32_t _first = Null;
+	uint32_t _last = Null;
+	uint32_t _capacity = 0;
+	uint32_t _used = 0;
+	uint32_t _allocations = 0;
+
+	static void Mapping(uint32_t size, int& sizeClass, int& bin) noexcept;
+	uint32_t FindFree(uint32_t size) const noexcept;
+	void InsertFree(uint32_t block);
+	void RemoveFree(uint32_t block);
+	uint32_t NewBlock();
+	/// <summary>
+	/// Shrinks block to size units and links a new block holding the rest after it, returned free but not in a bin
+	/// </summary>
+	uint32_t Split(uint32_t block, uint32_t size);
+	/// <summary>
+	/// Marks an allocated block free, merges it with its free neighbors and bins the result
+	/// </summary>
+	void Release(uint32_t block);
+	/// <summary>
+	/// Removes block from the address order and recycles its slot
+	/// </summary>
+	void Unlink(uint32_t block);
+};
@@ -1,8 +1,8 @@
 ﻿#include "World/Chunk.h"
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
-#include <chrono>
-#include <iostream>
+#include <cassert>
+#include <algorithm>
 
 //Use triangle strips to only have 8 vertices per chunk
 //On generation, create a vertex buffer of the vertices in the geometry, that way only one draw call is needed to render the entire chunk
@@ -13,13 +13,11 @@ SimplexNoise Chunk::mountainNoise(0.0003f, 1.0f, 2.8f, 0.45f);
 SimplexNoise Chunk::ridgeNoise(0.07f, 1.0f, 3.5f, 0.3f);
 SimplexNoise Chunk::caveNoise(1.0f, 1.0f, 2.0f, 0.5f);
 
+//Quad corners of each face, drawn as triangles v0 v1 v2 and v2 v1 v3 through the shared index buffer
 const uint8_t frontFace[] = {
     0, 1, 0,  // v0 bottom-left
     1, 1, 0,  // v1 bottom-right
     0, 1, 1,  // v2 top-left
-
-    0, 1, 1,  // v2 top-left
-    1, 1, 0,  // v1 bottom-right
     1, 1, 1,  // v3 top-right
 };
 
@@ -27,9 +25,6 @@ const uint8_t backFace[] = {
     1, 0, 0,  // v0 bottom-right
     0, 0, 0,  // v1 bottom-left
     1, 0, 1,  // v2 top-right
-
-    1, 0, 1,  // v2 top-right
-    0, 0, 0,  // v1 bottom-left
     0, 0, 1,  // v3 top-left
 };
 
@@ -37,9 +32,6 @@ const uint8_t leftFace[] = {
     0, 0, 0,  // v0 bottom-back
     0, 1, 0,  // v1 bottom-front
     0, 0, 1,  // v2 top-back
-
-    0, 0, 1,  // v2 top-back
-    0, 1, 0,  // v1 bottom-front
     0, 1, 1,  // v3 top-front
 };
 
@@ -47,9 +39,6 @@ const uint8_t rightFace[] = {
     1, 1, 0,  // v0 bottom-front
     1, 0, 0,  // v1 bottom-back
     1, 1, 1,  // v2 top-front
-
-    1, 1, 1,  // v2 top-front
-    1, 0, 0,  // v1 bottom-back
     1, 0, 1,  // v3 top-back
 };
 
@@ -57,9 +46,6 @@ const uint8_t bottomFace[] = {
     0, 0, 0,  // v0 back-left
     1, 0, 0,  // v1 back-right
     0, 1, 0,  // v2 front-left
-
-    0, 1, 0,  // v2 front-left
-    1, 0, 0,  // v1 back-right
     1, 1, 0,  // v3 front-right
 };
 
@@ -67,15 +53,31 @@ const uint8_t topFace[] = {
     0, 1, 1,  // v0 front-left
     1, 1, 1,  // v1 front-right
     0, 0, 1,  // v2 back-left
-
-    0, 0, 1,  // v2 back-left
-    1, 1, 1,  // v1 front-right
     1, 0, 1   // v3 back-right
 };
 
+//Indexed by face index, matches faceNormals in block.vert
+const uint8_t(*const faceVertices[6])[12] = {
+    &frontFace, &backFace, &leftFace, &rightFace, &bottomFace, &topFace
+};
+
+Chunk::Chunk() {
+    for (std::shared_ptr<ChunkSection>& section : sections)
+        section = std::make_shared<ChunkSection>();
+}
+
 void Chunk::Generate() {
+    if (!TryTransition(ChunkState::Queued, ChunkState::Generating))
+        return;
     //TODO: SimplexNoise implementation is not random, get a new one.
-	blocks = std::vector<int>(16 * 16 * 256, 0);
+    //no snapshot exists before the chunk is generated, so the sections are written in place
+    for (std::shared_ptr<ChunkSection>& section : sections)
+        section->Fill(0);
+    std::fill(std::begin(heightmap), std::end(heightmap), (int16_t)-1);
+    for (ColumnMask& column : opacity)
+        column.Reset();
+    int heights[16][16];
+    int minHeight = 255;
     for (int x = 0; x < 16; x++) {
         for (int y = 0; y < 16; y++) {
             
@@ -84,8 +86,21 @@ void Chunk::Generate() {
             float ridge = (1.0f - std::abs(ridgeNoise.fractal(3, worldX, worldY))) * 15.0f;
             float hill = hillNoise.fractal(5, worldX, worldY) * 10.0f;
             float mountain = mountainNoise.fractal(5, worldX, worldY) * 120.0f;
-            int totalHeight = 120 + hill + ridge;
-            for (int z = totalHeight; z >= 0; z--) {
+            heights[x][y] = 120 + hill + ridge;
+            minHeight = std::min(minHeight, heights[x][y]);
+        }
+    }
+    //Sections entirely below the dirt layer of every column are solid stone, fill them without touching each block
+    int stoneSections = std::max(0, minHeight - 2) / ChunkSection::Size;
+    for (int s = 0; s < stoneSections; s++)
+        sections[s]->Fill(1);
+    int stoneTop = stoneSections * ChunkSection::Size;
+    for (ColumnMask& column : opacity)
+        column.SetRange(0, stoneTop);
+    for (int x = 0; x < 16; x++) {
+        for (int y = 0; y < 16; y++) {
+            int totalHeight = heights[x][y];
+            for (int z = totalHeight; z >= stoneTop; z--) {
                 //Blocks
                 //3 grass
                 //2 dirt
@@ -101,144 +116,541 @@ void Chunk::Generate() {
             }
         }
     }
-    generated.store(true);
-    requiresRemesh.store(true);
+    for (std::shared_ptr<ChunkSection>& section : sections)
+        section->blocks.Compact();
+    //SetBlock kept the heightmap up to date while filling
+    dirtySections.store(0xFFFF);
+    //fails if the chunk was unloaded while generating, the data is never used then
+    TryTransition(ChunkState::Generating, ChunkState::Generated);
+}
+
+void Chunk::AppendDraws(DrawCommandBuilder& draws, const MeshArena& arena, const glm::vec3& cameraPosition) const {
+    //Camera relative to the chunk's box, x and y from 0 to 16 and z from meshBottom to meshTop.
+    //A direction's faces all lie inside the box, so it can only face the camera if the camera is past the box's far side against its normal
+    glm::vec3 camera = cameraPosition - glm::vec3(position * 16.0f, 0.0f);
+    bool visible[6] = {
+        camera.y > 0.0f,
+        camera.y < 16.0f,
+        camera.x < 16.0f,
+        camera.x > 0.0f,
+        camera.z < (float)meshTop,
+        camera.z > (float)meshBottom
+    };
+    //directions next to each other in the mesh are merged into one range, one draw each
+    draws.BeginChunk(glm::ivec2(position), arena.Offset(meshAllocation));
+    for (int face = 0; face < 6; face++) {
+        if (!visible[face])
+            continue;
+        int first = face;
+        while (face + 1 < 6 && visible[face + 1])
+            face++;
+        uint32_t start = meshOffsets[first * SectionCount];
+        uint32_t end = meshOffsets[(face + 1) * SectionCount];
+        draws.AddRange(start, end - start);
+    }
+}
+
+MeshBuild Chunk::BuildMesh(StagingRing& ring, MeshingMode mode) {
+    std::lock_guard<std::mutex> lock(meshMutex);
+    uint16_t dirty = snapshot.dirtySections;
+
+    static thread_local FaceMasks faceMasks;
+    for (int x = 0; x < 16; x++) {
+        for (int y = 0; y < 16; y++) {
+            if (snapshot.GetOpacity(x, y).Any())
+                snapshot.GetFaceMasks(x, y, faceMasks[x * 16 + y]);
+            else
+                for (ColumnMask& faces : faceMasks[x * 16 + y])
+                    faces.Reset();
+        }
+    }
+    //built per section and face into worker owned buffers that keep their capacity, then copied into the staging ring in mesh order
+    static thread_local std::vector<Vertex> faceBuffers[SectionCount][6];
+    for (int s = 0; s < SectionCount; s++) {
+        if (!(dirty & (1 << s)))
+            continue;
+        std::vector<Vertex>(&out)[6] = faceBuffers[s];
+        for (std::vector<Vertex>& faces : out)
+            faces.clear();
+        //Faces belong to the block they are on, an air section has none
+        if (snapshot.sections[s]->IsEmpty())
+            continue;
+        const ChunkSection& blocks = *snapshot.sections[s];
+        if (mode == MeshingMode::Greedy)
+            BuildGreedyMesh(faceMasks, blocks, s, out);
+        else
+            BuildNaiveMesh(faceMasks, blocks, s, out);
+    }
+    //a build that was never uploaded is always rebuilt by the next one, so dirty covers everything staged before
+    uint32_t vertexCount = 0;
+    for (int range = 0; range < RangeCount; range++) {
+        stagingOffsets[range] = vertexCount;
+        if (dirty & (1 << (range % SectionCount)))
+            vertexCount += (uint32_t)faceBuffers[range % SectionCount][range / SectionCount].size();
+    }
+    stagingOffsets[RangeCount] = vertexCount;
+    std::vector<Vertex>().swap(staging);
+    stagingAllocation = vertexCount > 0 ? ring.Allocate(vertexCount * sizeof(Vertex)) : StagingRing::Allocation();
+    //a full ring falls back to an exactly sized vector, uploaded from the cpu
+    Vertex* out = (Vertex*)stagingAllocation.data;
+    if (!stagingAllocation)
+        staging.reserve(vertexCount);
+    for (int s = 0; s < SectionCount; s++) {
+        if (dirty & (1 << s)) {
+            stagingTops[s] = 0;
+            stagingBottoms[s] = UINT16_MAX;
+        }
+    }
+    for (int range = 0; range < RangeCount; range++) {
+        int s = range % SectionCount;
+        if (!(dirty & (1 << s)))
+            continue;
+        const std::vector<Vertex>& faces = faceBuffers[s][range / SectionCount];
+        if (out)
+            std::copy(faces.begin(), faces.end(), out + stagingOffsets[range]);
+        else
+            staging.insert(staging.end(), faces.begin(), faces.end());
+        for (const Vertex& vertex : faces) {
+            stagingTops[s] = std::max<uint16_t>(stagingTops[s], (uint16_t)vertex.Z());
+            stagingBottoms[s] = std::min<uint16_t>(stagingBottoms[s], (uint16_t)vertex.Z());
+        }
+    }
+    stagingSections = dirty;
+    MeshBuild build;
+    build.version = snapshot.editVersion;
+    build.bytes = vertexCount * sizeof(Vertex);
+    build.inRing = (bool)stagingAllocation;
+
+    snapshot.Release();
+    return build;
+}
+
+/// <summary>
+/// Local position of column i along a side of the chunk, i runs along x for north and south and along y for east and west.
+/// Depth 0 is the chunk's own edge column, depth 1 the neighbor column just past it.
+/// </summary>
+static glm::ivec2 EdgeColumn(ChunkSide side, int i, int depth) {
+    switch (side) {
+    case ChunkSide::North:
+        return glm::ivec2(i, 15 + depth);
+    case ChunkSide::East:
+        return glm::ivec2(15 + depth, i);
+    case ChunkSide::South:
+        return glm::ivec2(i, -depth);
+    default:
+        return glm::ivec2(-depth, i);
+    }
 }
 
-void Chunk::Render(Shader& shader) {
-    glm::mat4 model(1.0f);
-    model = glm::translate(model, glm::vec3(position * 16.0f, 0.0f));
-    shader.setMat4("model", model);
-    glBindVertexArray(MeshVAO);
-    glDrawArrays(GL_TRIANGLES, 0, vertices.size());
-    glBindVertexArray(0);
+void Chunk::TakeSnapshot(const Chunk* north, const Chunk* east, const Chunk* south, const Chunk* west) {
+    uint16_t dirty = dirtySections.exchange(0);
+    snapshot.editVersion = editVersion;
+    snapshot.dirtySections = dirty;
+    //only the sections being rebuilt are read, the others can keep being edited in place
+    for (int s = 0; s < SectionCount; s++) {
+        if (dirty & (1 << s))
+            snapshot.sections[s] = sections[s];
+    }
+    sharedSections = dirty;
+    //the chunk's columns, then the apron of neighbor columns around them
+    const int padded = ChunkSnapshot::PaddedSize;
+    for (int x = 0; x < 16; x++)
+        std::copy_n(&opacity[x * 16], 16, &snapshot.opacity[(x + 1) * padded + 1]);
+    static const ColumnMask solid = ColumnMask::Range(0, 256);
+    const Chunk* neighbors[4] = { north, east, south, west };
+    for (int side = 0; side < 4; side++) {
+        const Chunk* neighbor = neighbors[side];
+        //only ever set here, sections built before the neighbor arrived stay provisional even if this snapshot has it
+        if (!neighbor)
+            provisionalSides |= 1 << side;
+        for (int i = 0; i < 16; i++) {
+            glm::ivec2 apron = EdgeColumn(ChunkSide(side), i, 1);
+            glm::ivec2 facing = EdgeColumn(Opposite(ChunkSide(side)), i, 0);
+            snapshot.opacity[(apron.x + 1) * padded + apron.y + 1] = neighbor ? neighbor->GetOpacity(facing.x, facing.y) : solid;
+        }
+    }
 }
 
-void Chunk::BuildMesh() {
-    if ((!NorthNeighbor || !NorthNeighbor->generated.load()) ||
-        (!SouthNeighbor || !SouthNeighbor->generated.load()) ||
-        (!EastNeighbor || !EastNeighbor->generated.load()) ||
-        (!WestNeighbor || !WestNeighbor->generated.load())
-        ) {
-        meshBuildQueued.store(false);
+void Chunk::PatchBorder(ChunkSide side, const Chunk& neighbor) {
+    uint8_t bit = 1 << (int)side;
+    if (!(provisionalSides & bit))
         return;
+    provisionalSides &= ~bit;
+    //The solid stand in hid every face on this side. The faces that belong there are where this chunk's edge is opaque
+    //and the neighbor's isn't, the sections without any keep their mesh
+    ColumnMask exposed;
+    for (int i = 0; i < 16; i++) {
+        glm::ivec2 edge = EdgeColumn(side, i, 0);
+        glm::ivec2 facing = EdgeColumn(Opposite(side), i, 0);
+        exposed |= GetOpacity(edge.x, edge.y).AndNot(neighbor.GetOpacity(facing.x, facing.y));
     }
-    // Reserve space for all possible faces once
-    auto start = std::chrono::high_resolution_clock::now();
+    uint16_t dirty = 0;
+    for (int s = 0; s < SectionCount; s++) {
+        if ((exposed.words[s >> 2] >> ((s & 3) * 16)) & 0xFFFF)
+            dirty |= 1 << s;
+    }
+    //not an edit, a build already in flight is still uploaded and these sections are rebuilt after it
+    dirtySections.fetch_or(dirty);
+}
 
-    //if (vertices.size() == 0)
-        //vertices.reserve(16 * 16 * 16 * 8);
-    stagingVertices.clear();
+void ChunkSnapshot::Release() {
+    for (std::shared_ptr<const ChunkSection>& section : sections)
+        section.reset();
+}
 
-    for (int x = 0; x < 16; x++) {
-        for (int y = 0; y < 16; y++) {
-            for (int z = 0; z < 256; z++) {
+void Chunk::MarkSectionsDirty(int z) {
+    int s = z >> 4;
+    uint16_t bits = 1 << s;
+    //faces on a section's top and bottom layer depend on the neighboring section
+    if ((z & 15) == 0 && s > 0)
+        bits |= 1 << (s - 1);
+    if ((z & 15) == 15 && s < SectionCount - 1)
+        bits |= 1 << (s + 1);
+    dirtySections.fetch_or(bits);
+    editVersion++;
+}
 
-                int block = GetBlock(x, y, z);
-                if (block == 0)
-                    continue;
+void Chunk::MarkSectionDirty(int s) {
+    dirtySections.fetch_or(1 << s);
+    editVersion++;
+}
 
-                glm::ivec3 position(x, y, z);
-                // Back face (−Y)
-                if (y == 0) {
-                    if (SouthNeighbor->GetBlock(x, 15, z) == 0) 
-                        AddFace(backFace, position, 1, block);
-                }
-                else if (GetBlock(x, y - 1, z) == 0)
-                    AddFace(backFace, position, 1, block);
+void Chunk::Reset() {
+    //block data, the heightmap and the opacity masks are all rewritten by Generate
+    std::fill(std::begin(meshOffsets), std::end(meshOffsets), 0);
+    std::fill(std::begin(sectionTops), std::end(sectionTops), 0);
+    std::fill(std::begin(sectionBottoms), std::end(sectionBottoms), 0);
+    meshTop = 0;
+    meshBottom = 0;
+    stagingAllocation = StagingRing::Allocation();
+    std::vector<Vertex>().swap(staging);
+    std::fill(std::begin(stagingOffsets), std::end(stagingOffsets), 0);
+    stagingSections = 0;
+    snapshot.Release();
+    sharedSections = 0;
+    editVersion = 0;
+    provisionalSides = 0;
+    dirtySections.store(0);
+    state.store(ChunkState::Queued);
+}
 
-                // Front face (+Y)
-                if (y == 15) {
-                    if (NorthNeighbor->GetBlock(x, 0, z) == 0)
-                        AddFace(frontFace, position, 0, block);
-                }
-                else if (GetBlock(x, y + 1, z) == 0) {
-                    AddFace(frontFace, position, 0, block);
-                }
+bool Chunk::IsValidTransition(ChunkState from, ChunkState to) {
+    switch (to) {
+    case ChunkState::Generating:
+        return from == ChunkState::Queued;
+    case ChunkState::Generated:
+        //Meshing goes back to Generated when an edit makes the finished build stale before it's uploaded
+        return from == ChunkState::Generating || from == ChunkState::Meshing;
+    case ChunkState::Meshing:
+        return from == ChunkState::Generated || from == ChunkState::Uploaded;
+    case ChunkState::Uploaded:
+        return from == ChunkState::Meshing;
+    case ChunkState::Unloading:
+        return from != ChunkState::Unloading;
+    default:
+        return false;
+    }
+}
 
-                // Left face (−X)
-                if (x == 0) {
-                    if (WestNeighbor && WestNeighbor->GetBlock(15, y, z) == 0)
-                        AddFace(leftFace, position, 2, block);
-                }
-                else if (GetBlock(x - 1, y, z) == 0) {
-                    AddFace(leftFace, position, 2, block);
-                }
+bool Chunk::TryTransition(ChunkState from, ChunkState to) {
+    assert(IsValidTransition(from, to) && "invalid chunk state transition");
+    return state.compare_exchange_strong(from, to);
+}
 
-                // Right face (+X)
-                if (x == 15) {
-                    if (EastNeighbor && EastNeighbor->GetBlock(0, y, z) == 0)
-                        AddFace(rightFace, position, 3, block);
-                }
-                else if (GetBlock(x + 1, y, z) == 0) {
-                    AddFace(rightFace, position, 3, block);
-                }
+void Chunk::MarkUnloading() {
+    state.store(ChunkState::Unloading);
+}
 
-                // Bottom face (−Z)
-                if (z == 0 || GetBlock(x, y, z - 1) == 0) {
-                    AddFace(bottomFace, position, 4, block);
-                }
+void ChunkSnapshot::GetFaceMasks(int x, int y, ColumnMask(&faces)[6]) const {
+    const ColumnMask* column = &GetOpacity(x, y);
+    const ColumnMask& north = column[1];
+    const ColumnMask& south = column[-1];
+    const ColumnMask& west = column[-PaddedSize];
+    const ColumnMask& east = column[PaddedSize];
+
+    //A face is visible where this column is opaque and the block on the other side of the face is not
+    faces[0] = column->AndNot(north);
+    faces[1] = column->AndNot(south);
+    faces[2] = column->AndNot(west);
+    faces[3] = column->AndNot(east);
+    faces[4] = column->AndNot(column->Below());
+    faces[5] = column->AndNot(column->Above());
+}
 
-                // Top face (+Z)
-                if (z == 255 || GetBlock(x, y, z + 1) == 0) {
-                    AddFace(topFace, position, 5, block);
+void Chunk::BuildNaiveMesh(const FaceMasks& faceMasks, const ChunkSection& blocks, int section, std::vector<Vertex>(&out)[6]) {
+    ColumnMask range = ColumnMask::Range(section * ChunkSection::Size, (section + 1) * ChunkSection::Size);
+    for (int x = 0; x < 16; x++) {
+        for (int y = 0; y < 16; y++) {
+            const ColumnMask(&faces)[6] = faceMasks[x * 16 + y];
+            ColumnMask visible = (faces[0] | faces[1] | faces[2] | faces[3] | faces[4] | faces[5]) & range;
+            visible.ForEachSetBit([&](int z) {
+                int block = blocks.GetBlock(x, y, z & 15);
+                glm::ivec3 position(x, y, z);
+                for (int face = 0; face < 6; face++) {
+                    if (faces[face].Test(z))
+                        AddFace(out[face], *faceVertices[face], position, face, block);
                 }
-            }
+            });
         }
     }
+}
 
-    auto end = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+/// <summary>
+/// Merges a width x height grid of face block IDs (0 = no face) into rectangles.
+/// Each cell is claimed by exactly one rectangle, the grid is cleared as it goes.
+/// </summary>
+template<typename F>
+static void GreedyMerge(int* ids, int width, int height, F&& emit) {
+    for (int v = 0; v < height; v++) {
+        for (int u = 0; u < width; u++) {
+            int id = ids[v * width + u];
+            if (id == 0)
+                continue;
+            int w = 1;
+            while (u + w < width && ids[v * width + u + w] == id)
+                w++;
+            int h = 1;
+            for (; v + h < height; h++) {
+                int* row = ids + (v + h) * width + u;
+                int i = 0;
+                while (i < w && row[i] == id)
+                    i++;
+                if (i < w)
+                    break;
+            }
+            for (int dv = 0; dv < h; dv++)
+                std::fill_n(ids + (v + dv) * width + u, w, 0);
+            emit(u, v, w, h, id);
+        }
+    }
+}
 
-    //std::cout << "BuildMesh took " << duration << " ms\n";
+void Chunk::BuildGreedyMesh(const FaceMasks& faceMasks, const ChunkSection& blocks, int section, std::vector<Vertex>(&out)[6]) {
+    static thread_local int ids[16 * ChunkSection::Size];
+    ColumnMask range = ColumnMask::Range(section * ChunkSection::Size, (section + 1) * ChunkSection::Size);
+
+    //Top and bottom faces, one 16x16 layer per z, merged across x (u) and y (v)
+    //Layers without any face of the direction are skipped
+    for (int face = 4; face < 6; face++) {
+        ColumnMask occupied;
+        for (const auto& faces : faceMasks)
+            occupied |= faces[face];
+        (occupied & range).ForEachSetBit([&](int z) {
+            for (int y = 0; y < 16; y++)
+                for (int x = 0; x < 16; x++)
+                    ids[y * 16 + x] = faceMasks[x * 16 + y][face].Test(z) ? blocks.GetBlock(x, y, z & 15) : 0;
+            GreedyMerge(ids, 16, 16, [&](int u, int v, int w, int h, int id) {
+                AddQuad(out[face], *faceVertices[face], glm::ivec3(u, v, z), glm::ivec3(w, h, 1), face, id);
+            });
+        });
+    }
+    //Side faces, one layer per x or y, merged across the horizontal axis (u) and z (v)
+    //Only the z range of the section that has faces in the layer is visited
+    for (int face = 0; face < 4; face++) {
+        bool alongX = face < 2;
+        for (int layer = 0; layer < 16; layer++) {
+            ColumnMask layerMask;
+            for (int u = 0; u < 16; u++)
+                layerMask |= faceMasks[alongX ? u * 16 + layer : layer * 16 + u][face];
+            layerMask = layerMask & range;
+            int zStart = layerMask.Lowest();
+            if (zStart < 0)
+                continue;
+            int height = layerMask.Highest() - zStart + 1;
+            for (int v = 0; v < height; v++) {
+                int z = zStart + v;
+                for (int u = 0; u < 16; u++) {
+                    int x = alongX ? u : layer;
+                    int y = alongX ? layer : u;
+                    ids[v * 16 + u] = faceMasks[x * 16 + y][face].Test(z) ? blocks.GetBlock(x, y, z & 15) : 0;
+                }
+            }
+            GreedyMerge(ids, 16, height, [&](int u, int v, int w, int h, int id) {
+                if (alongX)
+                    AddQuad(out[face], *faceVertices[face], glm::ivec3(u, layer, zStart + v), glm::ivec3(w, 1, h), face, id);
+                else
+                    AddQuad(out[face], *faceVertices[face], glm::ivec3(layer, u, zStart + v), glm::ivec3(1, w, h), face, id);
+            });
+        }
+    }
+}
 
-    stagingVertices.shrink_to_fit();
-    requiresRemesh.store(false);
-    meshBuildQueued.store(false);
+void Chunk::AddFace(std::vector<Vertex>& out, const uint8_t(&face)[12], const glm::ivec3& position, uint8_t texIndex, uint8_t blockID) {
+    AddQuad(out, face, position, glm::ivec3(1), texIndex, blockID);
 }
 
-void Chunk::AddFace(const uint8_t(&face)[18], const glm::ivec3& position, uint8_t texIndex, uint8_t blockID) {
-    for (int i = 0; i < 6; i++)
-        stagingVertices.push_back(Vertex(
-            face[i * 3] + position.x, face[i * 3 + 1] + position.y, face[i * 3 + 2] + position.z,
+void Chunk::AddQuad(std::vector<Vertex>& out, const uint8_t(&face)[12], const glm::ivec3& position, const glm::ivec3& size, uint8_t texIndex, uint8_t blockID) {
+    //face vertices are 0/1 offsets, scaling them by size stretches the unit face over the merged area
+    for (int i = 0; i < 4; i++)
+        out.push_back(Vertex(
+            face[i * 3] * size.x + position.x, face[i * 3 + 1] * size.y + position.y, face[i * 3 + 2] * size.z + position.z,
             texIndex, i, blockID
         ));
 }
 
+ChunkSection& Chunk::EditSection(int s) {
+    if (sharedSections & (1 << s)) {
+        //the snapshot keeps the old section alive until the build releases it
+        sections[s] = std::make_shared<ChunkSection>(*sections[s]);
+        sharedSections &= ~(1 << s);
+    }
+    return *sections[s];
+}
+
 void Chunk::SetBlock(int x, int y, int z, int ID) {
-    blocks[x * (16 * 256) + y * 256 + z] = ID;
-}
-
-void Chunk::UploadToGPU() {
-    vertices.clear();
-    vertices = std::move(stagingVertices);
-    glGenVertexArrays(1, &MeshVAO);
-    glGenBuffers(1, &MeshVBO);
-    //bind VAO
-    glBindVertexArray(MeshVAO);
-
-    //bind VBO
-    glBindBuffer(GL_ARRAY_BUFFER, MeshVBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
-
-    //position attrbute
-    glVertexAttribPointer(0, 3, GL_UNSIGNED_BYTE, GL_FALSE, 6 * sizeof(uint8_t), (void*)0);
-    glEnableVertexAttribArray(0);
-    //face index
-    glVertexAttribIPointer(1, 1, GL_UNSIGNED_BYTE, 6 * sizeof(uint8_t), (void*)(3 * sizeof(uint8_t)));
-    glEnableVertexAttribArray(1);
-    //tex index
-    glVertexAttribIPointer(2, 1, GL_UNSIGNED_BYTE, 6 * sizeof(uint8_t), (void*)(4 * sizeof(uint8_t)));
-    glEnableVertexAttribArray(2);
-    //block id
-    glVertexAttribIPointer(3, 1, GL_UNSIGNED_BYTE, 6 * sizeof(uint8_t), (void*)(5 * sizeof(uint8_t)));
-    glEnableVertexAttribArray(3);
-
-    glBindVertexArray(0);
-}
-
-void Chunk::ClearGPU() {
-    //clear mesh gpu data when the chunk is deleted
-    glDeleteBuffers(1, &MeshVBO);
-    glDeleteVertexArrays(1, &MeshVAO);
+    EditSection(z >> 4).SetBlock(x, y, z & 15, ID);
+    if (ID != 0)
+        opacity[x * 16 + y].Set(z);
+    else
+        opacity[x * 16 + y].Clear(z);
+    int16_t& height = heightmap[x * 16 + y];
+    if (ID != 0) {
+        if (z > height)
+            height = z;
+        return;
+    }
+    if (z != height)
+        return;
+    //the top block was removed, walk down to the next solid block, skipping air sections
+    int next = z - 1;
+    while (next >= 0) {
+        const ChunkSection& section = *sections[next >> 4];
+        if (section.IsEmpty()) {
+            next = (next & ~15) - 1;
+            continue;
+        }
+        if (section.GetBlock(x, y, next & 15) != 0)
+            break;
+        next--;
+    }
+    height = next;
+}
+
+size_t Chunk::MemoryUsage() const {
+    size_t bytes = 0;
+    for (const std::shared_ptr<ChunkSection>& section : sections)
+        bytes += section->blocks.MemoryUsage();
+    return bytes;
+}
+
+size_t Chunk::CpuBytes() const {
+    std::lock_guard<std::mutex> lock(meshMutex);
+    return sizeof(Chunk) + SectionCount * sizeof(ChunkSection) + MemoryUsage() + staging.capacity() * sizeof(Vertex);
+}
+
+void Chunk::UploadToGPU(MeshArena& arena, StagingRing& ring) {
+    std::lock_guard<std::mutex> lock(meshMutex);
+    if (stagingSections == 0)
+        return;
+    auto rebuilt = [this](int range) {
+        return (stagingSections >> (range % SectionCount)) & 1;
+    };
+    //Splice the rebuilt sections into the chunk mesh, untouched sections keep their vertices
+    uint32_t offsets[RangeCount + 1];
+    uint32_t vertexCount = 0;
+    for (int range = 0; range < RangeCount; range++) {
+        offsets[range] = vertexCount;
+        if (rebuilt(range))
+            vertexCount += stagingOffsets[range + 1] - stagingOffsets[range];
+        else
+            vertexCount += meshOffsets[range + 1] - meshOffsets[range];
+    }
+    offsets[RangeCount] = vertexCount;
+
+    //Kept ranges only exist on the gpu. The ones that move, because a range before them changed size or the mesh moves
+    //to a larger allocation, are parked in the scratch buffer from the first one on and copied back into place,
+    //glCopyBufferSubData can't copy between overlapping parts of one buffer
+    bool grow = vertexCount > meshCapacity;
+    uint32_t parkStart = meshOffsets[RangeCount];
+    for (int range = 0; range < RangeCount; range++) {
+        bool kept = !rebuilt(range) && meshOffsets[range + 1] > meshOffsets[range];
+        if (kept && (grow || offsets[range] != meshOffsets[range])) {
+            parkStart = meshOffsets[range];
+            break;
+        }
+    }
+    uint32_t parked = meshOffsets[RangeCount] - parkStart;
+    uint32_t meshStart = meshAllocation != ArenaAllocator::InvalidHandle ? arena.Offset(meshAllocation) : 0;
+    GLuint scratch = 0;
+    if (parked > 0) {
+        scratch = arena.ScratchBuffer(parked);
+        glBindBuffer(GL_COPY_READ_BUFFER, arena.VertexBuffer());
+        glBindBuffer(GL_COPY_WRITE_BUFFER, scratch);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, (size_t)(meshStart + parkStart) * sizeof(Vertex), 0, parked * sizeof(Vertex));
+    }
+    if (grow) {
+        //freed first so the new allocation can reuse the old one along with any free space after it
+        if (meshAllocation != ArenaAllocator::InvalidHandle)
+            arena.Free(meshAllocation);
+        //grow with headroom so small edits splice in place
+        meshCapacity = std::max(vertexCount, meshCapacity * 2);
+        meshAllocation = arena.Allocate(meshCapacity);
+        meshStart = arena.Offset(meshAllocation);
+    }
+    //bound after allocating, growing the arena replaces its buffer
+    glBindBuffer(GL_ARRAY_BUFFER, arena.VertexBuffer());
+    glBindBuffer(GL_COPY_WRITE_BUFFER, arena.VertexBuffer());
+    //consecutive rebuilt ranges are contiguous in staging and consecutive kept ranges in the old mesh,
+    //so each run is one copy, or one upload if the build didn't fit in the ring
+    for (int range = 0; range < RangeCount; range++) {
+        bool fromStaging = rebuilt(range);
+        int first = range;
+        while (range + 1 < RangeCount && rebuilt(range + 1) == fromStaging)
+            range++;
+        size_t count = offsets[range + 1] - offsets[first];
+        if (count == 0)
+            continue;
+        size_t target = (size_t)(meshStart + offsets[first]) * sizeof(Vertex);
+        if (fromStaging && stagingAllocation) {
+            glBindBuffer(GL_COPY_READ_BUFFER, ring.Buffer());
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, stagingAllocation.offset + stagingOffsets[first] * sizeof(Vertex), target, count * sizeof(Vertex));
+        }
+        else if (fromStaging)
+            glBufferSubData(GL_ARRAY_BUFFER, target, count * sizeof(Vertex), staging.data() + stagingOffsets[first]);
+        else if (meshOffsets[first] >= parkStart && parked > 0) {
+            glBindBuffer(GL_COPY_READ_BUFFER, scratch);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, (meshOffsets[first] - parkStart) * sizeof(Vertex), target, count * sizeof(Vertex));
+        }
+    }
+
+    for (int s = 0; s < SectionCount; s++) {
+        if (stagingSections & (1 << s)) {
+            sectionTops[s] = stagingTops[s];
+            sectionBottoms[s] = stagingBottoms[s];
+        }
+    }
+    meshTop = *std::max_element(std::begin(sectionTops), std::end(sectionTops));
+    std::copy(std::begin(offsets), std::end(offsets), std::begin(meshOffsets));
+    //the lowest section with any faces holds the lowest vertex
+    meshBottom = meshTop;
+    for (int s = 0; s < SectionCount; s++) {
+        uint32_t sectionVertices = 0;
+        for (int face = 0; face < 6; face++)
+            sectionVertices += meshOffsets[face * SectionCount + s + 1] - meshOffsets[face * SectionCount + s];
+        if (sectionVertices > 0) {
+            meshBottom = sectionBottoms[s];
+            break;
+        }
+    }
+    //the copies are recorded, the ring space comes back once the frame's fence passes
+    ReleaseStaging(ring);
+
+    //quad indices are the same for every chunk, the shared buffer only has to cover the largest mesh
+    arena.EnsureIndexCapacity(vertexCount / 4);
+}
+
+void Chunk::ReleaseStaging(StagingRing& ring) {
+    ring.Release(stagingAllocation);
+    stagingAllocation = StagingRing::Allocation();
+    std::vector<Vertex>().swap(staging);
+    stagingSections = 0;
+}
+
+void Chunk::FreeMesh(MeshArena& arena, StagingRing& ring) {
+    ReleaseStaging(ring);
+    if (meshAllocation != ArenaAllocator::InvalidHandle)
+        arena.Free(meshAllocation);
+    meshAllocation = ArenaAllocator::InvalidHandle;
+    meshCapacity = 0;
+    std::fill(std::begin(meshOffsets), std::end(meshOffsets), 0);
 }
@@ -3,19 +3,173 @@
 #include <unordered_map>
 #include "OpenGL/Shader.h"
 #include "Generation/SimplexNoise.h"
+#include "World/ChunkSection.h"
+#include "World/ColumnMask.h"
+#include "World/Vertex.h"
+#include "World/MeshArena.h"
+#include "World/StagingRing.h"
 #include <optional>
 #include <mutex>
+#include <atomic>
+#include <memory>
+#include <utility>
 #include <glad/glad.h>
 
-struct Vertex {
-	uint8_t x, y, z;
-	uint8_t face;
-	uint8_t corner;
-	uint8_t block;
-	Vertex(uint8_t x, uint8_t y, uint8_t z, uint8_t f, uint8_t c, uint8_t b) : x(x), y(y), z(z), face(f), corner(c), block(b) {}
+
+enum class MeshingMode {
+	/// <summary>
+	/// One quad per visible block face
+	/// </summary>
+	Naive,
+	/// <summary>
+	/// Coplanar faces with the same block ID and direction are merged into larger quads
+	/// </summary>
+	Greedy
+};
+
+/// <summary>
+/// Where a chunk is in its life, from being queued for generation to being unloaded.
+/// Transitions are made with Chunk::TryTransition, which rejects any not listed in Chunk::IsValidTransition.
+/// </summary>
+enum class ChunkState : uint8_t {
+	/// <summary>
+	/// Created and waiting for a generation job
+	/// </summary>
+	Queued,
+	Generating,
+	/// <summary>
+	/// Block data is ready, the mesh is missing or out of date
+	/// </summary>
+	Generated,
+	/// <summary>
+	/// A mesh job is queued or running, or its result is waiting to be uploaded
+	/// </summary>
+	Meshing,
+	/// <summary>
+	/// The mesh on the gpu matches the block data as of the last build
+	/// </summary>
+	Uploaded,
+	/// <summary>
+	/// Out of range and removed from the world, deleted once nothing references it
+	/// </summary>
+	Unloading
+};
+
+/// <summary>
+/// Side of a chunk, the neighbor on the north side is at position + (0, 1) and on the east side at position + (1, 0)
+/// </summary>
+enum class ChunkSide : uint8_t {
+	North,
+	East,
+	South,
+	West
+};
+
+inline ChunkSide Opposite(ChunkSide side) noexcept {
+	return ChunkSide(((int)side + 2) & 3);
+}
+
+/// <summary>
+/// What a mesh build staged, handed from the meshing worker to the render thread along with the chunk
+/// </summary>
+struct MeshBuild {
+	/// <summary>
+	/// Chunk::editVersion of the snapshot the build read
+	/// </summary>
+	uint32_t version = 0;
+	/// <summary>
+	/// Bytes of vertex data waiting to be uploaded
+	/// </summary>
+	size_t bytes = 0;
+	/// <summary>
+	/// True if the vertices were written into the staging ring, false if it was full and they are in Chunk::staging
+	/// </summary>
+	bool inRing = false;
+};
+
+/// <summary>
+/// The block data a mesh build reads, taken on the main thread when the build is scheduled so edits made while it runs can't tear it.
+/// Dirty sections are shared with the chunk instead of copied, the chunk copies a section before editing it while a snapshot holds it.
+/// </summary>
+struct ChunkSnapshot {
+	/// <summary>
+	/// Chunk::editVersion when the snapshot was taken
+	/// </summary>
+	uint32_t editVersion = 0;
+	/// <summary>
+	/// Sections to rebuild, bit n for section n. Only these are held in sections.
+	/// </summary>
+	uint16_t dirtySections = 0;
+	std::shared_ptr<const ChunkSection> sections[16];
+	/// <summary>
+	/// Columns per side of the opacity apron, the chunk's 16 plus the neighbor column on either side
+	/// </summary>
+	static constexpr int PaddedSize = 18;
+	/// <summary>
+	/// Opacity of the chunk's columns and the neighbor columns bordering them, indexed (x + 1) * PaddedSize + y + 1 for x and y in [-1, 16].
+	/// Face culling never looks diagonally, so the four corner columns stay empty.
+	/// The columns of a neighbor that wasn't generated yet are fully opaque, hiding every face on that side until it arrives.
+	/// </summary>
+	ColumnMask opacity[PaddedSize * PaddedSize];
+
+	/// <summary>
+	/// Opacity of column (x, y), x and y may be one past either edge of the chunk
+	/// </summary>
+	inline const ColumnMask& GetOpacity(int x, int y) const noexcept {
+		return opacity[(x + 1) * PaddedSize + y + 1];
+	}
+	/// <summary>
+	/// Visible face masks of column (x, y), indexed by face index. The apron puts every neighbor column at a fixed offset, so there are no edge cases.
+	/// </summary>
+	void GetFaceMasks(int x, int y, ColumnMask(&faces)[6]) const;
+	/// <summary>
+	/// Drops the shared sections, letting any the chunk has replaced since be freed
+	/// </summary>
+	void Release();
+};
+
+struct Chunk;
+
+/// <summary>
+/// Counted reference that pins a chunk. An unloading chunk is only deleted once no ChunkRef points at it,
+/// so jobs and queues holding one can keep reading it after it leaves the world.
+/// </summary>
+class ChunkRef {
+public:
+	ChunkRef() = default;
+	explicit ChunkRef(Chunk* chunk);
+	ChunkRef(const ChunkRef& other);
+	ChunkRef(ChunkRef&& other) noexcept : _chunk(other._chunk) {
+		other._chunk = nullptr;
+	}
+	ChunkRef& operator=(ChunkRef other) noexcept {
+		std::swap(_chunk, other._chunk);
+		return *this;
+	}
+	~ChunkRef();
+	inline Chunk* Get() const noexcept {
+		return _chunk;
+	}
+	inline Chunk* operator->() const noexcept {
+		return _chunk;
+	}
+	explicit operator bool() const noexcept {
+		return _chunk != nullptr;
+	}
+private:
+	Chunk* _chunk = nullptr;
 };
 
 struct Chunk {
+	static constexpr int SectionCount = 16;
+	/// <summary>
+	/// Number of ranges the mesh is split into, one per face direction per section
+	/// </summary>
+	static constexpr int RangeCount = 6 * SectionCount;
+	/// <summary>
+	/// Visible face masks of every column, indexed [x * 16 + y][face index]
+	/// </summary>
+	using FaceMasks = ColumnMask[16 * 16][6];
 	static SimplexNoise hillNoise;
 	static SimplexNoise mountainNoise;
 	static SimplexNoise ridgeNoise;
@@ -28,49 +182,244 @@ struct Chunk {
 	/// </summary>
 	glm::vec2 position;
 	/// <summary>
-	/// The mesh generation data. Stores what blockID is at what position
+	/// The mesh generation data. Stores what blockID is at what position.
+	/// Split into 16 vertical sections, section n holds z = n * 16 to n * 16 + 15.
+	/// Air and fully underground sections are stored as a single block ID.
+	/// Shared with the snapshot of a mesh build in flight, see sharedSections.
+	/// </summary>
+	std::shared_ptr<ChunkSection> sections[SectionCount];
+	/// <summary>
+	/// Bit n is set while a snapshot may still be reading section n, editing it then replaces it with a copy.
+	/// Main thread only, cleared when the build's result is taken off the queue.
+	/// </summary>
+	uint16_t sharedSections = 0;
+	/// <summary>
+	/// Incremented by every edit that dirties a section of the generated chunk, including edits in a neighbor that change its border.
+	/// Main thread only. A mesh built from an older version is stale and is thrown away at upload.
+	/// </summary>
+	uint32_t editVersion = 0;
+	/// <summary>
+	/// Input of the mesh build in flight, written by TakeSnapshot and released by BuildMesh
+	/// </summary>
+	ChunkSnapshot snapshot;
+	/// <summary>
+	/// Bit n is set if the last snapshot stood in solid columns for the missing neighbor on ChunkSide n,
+	/// so the faces on that side are provisional until PatchBorder runs. Main thread only.
+	/// </summary>
+	uint8_t provisionalSides = 0;
+	/// <summary>
+	/// Z of the highest non air block in each column, indexed x * 16 + y. -1 if the column is empty.
+	/// </summary>
+	int16_t heightmap[16 * 16];
+	/// <summary>
+	/// One 256 bit opacity mask per column, indexed x * 16 + y. Kept in sync with the block data by SetBlock.
+	/// </summary>
+	ColumnMask opacity[16 * 16];
+	/// <summary>
+	/// Vertex offset of each range of the mesh from the start of the chunk's allocation, range face * SectionCount + section. meshOffsets[RangeCount] is the vertex count.
+	/// The mesh is grouped by face direction and then by section, so direction face is the one contiguous range
+	/// meshOffsets[face * SectionCount] to meshOffsets[(face + 1) * SectionCount] that AppendDraws can skip.
+	/// Only the offsets are kept on the cpu, the vertices live on the gpu alone.
 	/// </summary>
-	std::vector<int> blocks;
+	uint32_t meshOffsets[RangeCount + 1] = {};
 	/// <summary>
-	/// The mesh vertex data that is uploaded to the gpu
+	/// Highest vertex z of each section's faces, 0 if it has none
 	/// </summary>
-	std::vector<Vertex> vertices;
-	//thread safety, used only by worker thread when building mesh
-	std::vector<Vertex> stagingVertices;
-	std::mutex meshMutex;
-	Chunk* NorthNeighbor = nullptr;
-	Chunk* EastNeighbor = nullptr;
-	Chunk* SouthNeighbor = nullptr;
-	Chunk* WestNeighbor = nullptr;
+	uint16_t sectionTops[SectionCount] = {};
+	/// <summary>
+	/// Lowest vertex z of each section's faces, only meaningful for sections that have faces
+	/// </summary>
+	uint16_t sectionBottoms[SectionCount] = {};
+	/// <summary>
+	/// Highest vertex z in the mesh, the top of the box AppendDraws tests face directions against and the frustum is tested against
+	/// </summary>
+	uint32_t meshTop = 0;
+	/// <summary>
+	/// Lowest vertex z in the mesh, the bottom of the same box
+	/// </summary>
+	uint32_t meshBottom = 0;
+	/// <summary>
+	/// Handle of the chunk's allocation in the mesh arena, meshCapacity vertices long. The arena can move it, its offset is looked up when drawing.
+	/// </summary>
+	uint32_t meshAllocation = ArenaAllocator::InvalidHandle;
+	/// <summary>
+	/// Vertices allocated for the chunk in the mesh arena, 0 if it has no allocation
+	/// </summary>
+	uint32_t meshCapacity = 0;
+	/// <summary>
+	/// Vertices of the sections rebuilt by BuildMesh in mesh order, waiting to be spliced into the mesh arena by UploadToGPU.
+	/// Written straight into the staging ring, staging only holds them when the ring had no room.
+	/// </summary>
+	StagingRing::Allocation stagingAllocation;
+	/// <summary>
+	/// Exactly sized by the build and freed by the upload
+	/// </summary>
+	std::vector<Vertex> staging;
+	/// <summary>
+	/// Offset of each range in the staged vertices, laid out like meshOffsets. Ranges of sections that weren't rebuilt are empty.
+	/// </summary>
+	uint32_t stagingOffsets[RangeCount + 1] = {};
+	/// <summary>
+	/// sectionTops of the rebuilt sections, found by the build so the upload never reads the mapped staging memory back
+	/// </summary>
+	uint16_t stagingTops[SectionCount] = {};
+	uint16_t stagingBottoms[SectionCount] = {};
+	uint16_t stagingSections = 0;
+	//thread safety, guards the staging buffer between the meshing worker and the upload
+	mutable std::mutex meshMutex;
 
 	//Thread Safety
-	std::atomic<bool> generated{ false };
+	std::atomic<ChunkState> state{ ChunkState::Queued };
 	/// <summary>
-	/// True if the mesh operation has already been scheduled.
+	/// Number of ChunkRefs pointing at this chunk
 	/// </summary>
-	std::atomic<bool> meshBuildQueued{ false };
+	std::atomic<int> references{ 0 };
 	/// <summary>
-	/// True if the mesh data has been uploaded to the gpu
+	/// Bit n is set if section n has to be remeshed
 	/// </summary>
-	std::atomic<bool> uploadComplete{ false };
+	std::atomic<uint16_t> dirtySections{ 0 };
+	Chunk();
+	static bool IsValidTransition(ChunkState from, ChunkState to);
 	/// <summary>
-	/// True if the mesh needs to be rebuilt after an update
+	/// Moves the chunk from one state to another. Returns false if the chunk wasn't in the from state,
+	/// which happens when it has been unloaded by the main thread in the meantime.
+	/// </summary>
+	bool TryTransition(ChunkState from, ChunkState to);
+	/// <summary>
+	/// Moves the chunk to Unloading from any state
+	/// </summary>
+	void MarkUnloading();
+	inline ChunkState GetState() const noexcept {
+		return state.load();
+	}
+	/// <summary>
+	/// True if the block data is ready and the chunk isn't being unloaded
+	/// </summary>
+	inline bool IsGenerated() const noexcept {
+		ChunkState current = state.load();
+		return current == ChunkState::Generated || current == ChunkState::Meshing || current == ChunkState::Uploaded;
+	}
+	/// <summary>
+	/// True if any section has changed since its last mesh build
+	/// </summary>
+	inline bool NeedsMesh() const noexcept {
+		return dirtySections.load() != 0;
+	}
+	/// <summary>
+	/// Returns the chunk to a freshly constructed Queued state for reuse by ChunkPool.
+	/// Block storage keeps its capacity and the GL objects are kept, so the next life of the chunk doesn't allocate them again.
+	/// </summary>
+	void Reset();
+	/// <summary>
+	/// True once a non empty mesh has been uploaded. Main thread only.
+	/// </summary>
+	inline bool HasMesh() const noexcept {
+		return meshOffsets[RangeCount] != 0;
+	}
+	/// <summary>
+	/// Generates the block data, moving the chunk from Queued to Generated. Does nothing if the chunk was unloaded first.
 	/// </summary>
-	std::atomic<bool> requiresRemesh{ false };
-	std::atomic<bool> scheduledForDeletion{ false };
-	GLuint MeshVAO = 0, MeshVBO = 0;
 	void Generate();
-	void Render(Shader& shader);
-	void BuildMesh();
-	void AddFace(const uint8_t(&face)[18], const glm::ivec3& position, uint8_t texIndex, uint8_t blockID);
+	/// <summary>
+	/// World space box around the uploaded mesh, the chunk's 16 by 16 columns from meshBottom to meshTop
+	/// </summary>
+	inline void GetBounds(glm::vec3& min, glm::vec3& max) const noexcept {
+		min = glm::vec3(position * 16.0f, (float)meshBottom);
+		max = glm::vec3(position * 16.0f + 16.0f, (float)meshTop);
+	}
+	/// <summary>
+	/// Adds a draw for the face directions that can face the camera. A direction is skipped when the camera is behind
+	/// the plane of every face it could have inside the chunk's box, at most three are drawn from outside the box.
+	/// </summary>
+	void AppendDraws(DrawCommandBuilder& draws, const MeshArena& arena, const glm::vec3& cameraPosition) const;
+	/// <summary>
+	/// Captures the dirty sections, the opacity masks and the border columns of the generated neighbors for the next BuildMesh,
+	/// and clears the dirty flags. A null neighbor is treated as solid and its side recorded in provisionalSides. Main thread only.
+	/// </summary>
+	void TakeSnapshot(const Chunk* north, const Chunk* east, const Chunk* south, const Chunk* west);
+	/// <summary>
+	/// Called when the neighbor on side has been generated. If the mesh treated it as solid, dirties only the sections
+	/// where the neighbor's border actually exposes faces, rather than remeshing the whole chunk. Main thread only.
+	/// </summary>
+	void PatchBorder(ChunkSide side, const Chunk& neighbor);
+	/// <summary>
+	/// Rebuilds the sections dirty in the snapshot into an allocation of the staging ring, or the staging vector if the ring is full,
+	/// then releases the snapshot. Reads nothing but the snapshot, so it can run while the main thread edits the chunk and its neighbors.
+	/// </summary>
+	MeshBuild BuildMesh(StagingRing& ring, MeshingMode mode = MeshingMode::Greedy);
+	/// <summary>
+	/// Flags the sections whose mesh depends on the block at height z, including the section above or below on a section border.
+	/// Counts as an edit, main thread only.
+	/// </summary>
+	void MarkSectionsDirty(int z);
+	void MarkSectionDirty(int s);
+	/// <summary>
+	/// Meshes one section of the snapshot, blocks is that section
+	/// </summary>
+	void BuildNaiveMesh(const FaceMasks& faceMasks, const ChunkSection& blocks, int section, std::vector<Vertex>(&out)[6]);
+	void BuildGreedyMesh(const FaceMasks& faceMasks, const ChunkSection& blocks, int section, std::vector<Vertex>(&out)[6]);
+	void AddFace(std::vector<Vertex>& out, const uint8_t(&face)[12], const glm::ivec3& position, uint8_t texIndex, uint8_t blockID);
+	/// <summary>
+	/// Adds a face stretched over size blocks, size is 1 along the face normal.
+	/// </summary>
+	void AddQuad(std::vector<Vertex>& out, const uint8_t(&face)[12], const glm::ivec3& position, const glm::ivec3& size, uint8_t texIndex, uint8_t blockID);
 	inline int GetBlock(int x, int y, int z) const noexcept {
     // Fast path, no branching if you already guarantee valid ranges (015, 015, 0255)
-		return blocks[x * (16 * 256) + y * 256 + z];
+		return sections[z >> 4]->GetBlock(x, y, z & 15);
 	}
 	void SetBlock(int x, int y, int z, int ID);
-	void UploadToGPU();
-	void ClearGPU();
-	~Chunk() {
-		ClearGPU();
+	/// <summary>
+	/// Section s ready to be written, copied first if a snapshot shares it
+	/// </summary>
+	ChunkSection& EditSection(int s);
+	inline int GetHeight(int x, int y) const noexcept {
+		return heightmap[x * 16 + y];
+	}
+	inline const ColumnMask& GetOpacity(int x, int y) const noexcept {
+		return opacity[x * 16 + y];
 	}
-};
\ No newline at end of file
+	/// <summary>
+	/// Heap bytes used by block storage
+	/// </summary>
+	size_t MemoryUsage() const;
+	/// <summary>
+	/// Cpu bytes held by the chunk, the chunk itself, its block storage and any mesh waiting to be uploaded
+	/// Waits for a mesh build in progress, call it from the main thread
+	/// </summary>
+	size_t CpuBytes() const;
+	/// <summary>
+	/// Bytes of the mesh arena allocated to the chunk
+	/// </summary>
+	inline size_t GpuBytes() const noexcept {
+		return (size_t)meshCapacity * sizeof(Vertex);
+	}
+	/// <summary>
+	/// Splices the staged sections into the chunk's allocation in the arena, moving it to a larger one if the mesh outgrew it.
+	/// Vertices in the staging ring are copied on the gpu, only ones in the staging vector are uploaded from the cpu.
+	/// </summary>
+	void UploadToGPU(MeshArena& arena, StagingRing& ring);
+	/// <summary>
+	/// Hands the staged vertices back to the ring and frees the staging vector. Main thread, never while a build runs.
+	/// </summary>
+	void ReleaseStaging(StagingRing& ring);
+	/// <summary>
+	/// Returns the chunk's allocation to the arena and anything it still has staged to the ring, done before the chunk goes back to the pool
+	/// </summary>
+	void FreeMesh(MeshArena& arena, StagingRing& ring);
+};
+
+inline ChunkRef::ChunkRef(Chunk* chunk) : _chunk(chunk) {
+	if (_chunk)
+		_chunk->references.fetch_add(1, std::memory_order_relaxed);
+}
+
+inline ChunkRef::ChunkRef(const ChunkRef& other) : _chunk(other._chunk) {
+	if (_chunk)
+		_chunk->references.fetch_add(1, std::memory_order_relaxed);
+}
+
+inline ChunkRef::~ChunkRef() {
+	//release so everything done through this reference happens before the main thread sees the count reach 0
+	if (_chunk)
+		_chunk->references.fetch_sub(1, std::memory_order_release);
+}
\ No newline at end of file
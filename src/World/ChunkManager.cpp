@@ -1,169 +1,294 @@
 #include "World/ChunkManager.h"
 #include "Entities/Player.h"
+#include <algorithm>
 
-ChunkManager::ChunkManager(std::shared_ptr<Player> player) : _player(player) {
-    _generationPool = std::make_unique<ThreadPool>(1);
-    _meshingPool = std::make_unique<ThreadPool>(1);
-    _worldUpdatePool = std::make_unique<ThreadPool>(1);
+//Offset of the neighbor on each side, indexed by ChunkSide
+static const glm::ivec2 SideOffsets[4] = { glm::ivec2(0, 1), glm::ivec2(1, 0), glm::ivec2(0, -1), glm::ivec2(-1, 0) };
+
+static inline int DistanceSquared(const glm::ivec2& a, const glm::ivec2& b) {
+    glm::ivec2 offset = a - b;
+    return offset.x * offset.x + offset.y * offset.y;
+}
+
+ChunkManager::ChunkManager(std::shared_ptr<Player> player, unsigned int generationThreads, unsigned int meshingThreads) : _player(player) {
+    //hardware_concurrency may report 0 when it can't be determined
+    unsigned int hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+    _generationPool = std::make_unique<JobSystem>(generationThreads ? generationThreads : hardwareThreads);
+    _meshingPool = std::make_unique<JobSystem>(meshingThreads ? meshingThreads : hardwareThreads);
+    _generationScheduler = std::make_unique<ChunkScheduler>(*_generationPool);
+    _meshingScheduler = std::make_unique<ChunkScheduler>(*_meshingPool);
 
     //TODO: update based on where the player position starts at
     //create first 9 chunks that the player is standing on
     for (int x = -1; x <= 1; x++) {
         for (int y = -1; y <= 1; y++) {
             glm::ivec2 position(x, y);
-            _worldChunks[position] = new Chunk();
-            Chunk* newChunk = _worldChunks[position];
-            newChunk->position = position;
+            Chunk* newChunk = _chunkPool.Acquire(position);
+            _worldChunks.Insert(position, newChunk);
             newChunk->Generate();
+            _meshRequests.emplace_back(newChunk);
         }
     }
-    //Set player spawn point
-    int z = 255;
-    while (GetGlobalBlock(glm::vec3(0, 0, z)) == 0) {
-        z--;
-    }
-    _player->SetPosition(glm::vec3(0, 0, z));
+    //Set player spawn point on top of the highest block
+    _player->SetPosition(glm::vec3(0, 0, GetSurfaceHeight(0, 0)));
 }
 
-void ChunkManager::Update(Shader& blockShader) {
+void ChunkManager::Update(Shader& blockShader, const glm::mat4& projection) {
     glm::vec3 playerPosition = _player->GetPosition();
+    //jobs waiting in the schedulers are reordered around where the player is now and where they are looking
+    glm::vec2 viewCenter = glm::vec2(playerPosition) / 16.0f;
+    _generationScheduler->SetView(viewCenter, _player->GetFront());
+    _meshingScheduler->SetView(viewCenter, _player->GetFront());
     blockShader.use();
-    if (!clearingChunks.load()) {
-        _worldUpdatePool->enqueue([this, playerPosition] {
-            CheckChunksForDeletion(playerPosition);
-            });
-        clearingChunks.store(true);
-    }
-    //loop through chunks in spiral starting from player position
-    int x = 0;
-    int y = 0;
-    int dx = 0;
-    int dy = -1;
+    const glm::vec3& cameraPosition = _player->GetCameraPosition();
 
     //Free any chunks in cleanup buffer
     ProcessMeshUpload();
     ProcessChunkCleanup();
-    for (int i = 0; i < (RenderDistance * 2) * (RenderDistance * 2); i++) {
-        std::lock_guard<std::mutex> lock(_worldChunksMutex);
-        glm::ivec2 position(playerPosition.x / 16.0f + x, playerPosition.y / 16.0f + y);
-        if (std::sqrt(x * x + y * y) <= RenderDistance) {
-            Chunk* chunk = _worldChunks[position];
-            //Don't operate on the chunk if it has been scheduled for deletion
-            if (chunk) {
-                //Do nothing if the chunk hasn't been generated yet
-                if (!chunk->generated.load())
-                    continue;
-
-                if (chunk->scheduledForDeletion.load())
-                    continue;
-
-                //render the chunk if it has a valid mesh
-                if (chunk->uploadComplete.load()) {
-                    chunk->Render(blockShader);
-                }
-                if (!chunk->meshBuildQueued.load() && chunk->requiresRemesh.load()) {
-                    //std::cout << "here" << std::endl;
-                    //Update the chunks neighbors when the mesh is built so it can access the neighbor chunks for proper face culling
-                    auto it = _worldChunks.find(position + glm::ivec2(0, 1));
-                    if (it != _worldChunks.end())
-                        chunk->NorthNeighbor = it->second;
-
-                    it = _worldChunks.find(position + glm::ivec2(1, 0));
-                    if (it != _worldChunks.end())
-                        chunk->EastNeighbor = it->second;
-
-                    it = _worldChunks.find(position + glm::ivec2(0, -1));
-                    if (it != _worldChunks.end())
-                        chunk->SouthNeighbor = it->second;
-
-                    it = _worldChunks.find(position + glm::ivec2(-1, 0));
-                    if (it != _worldChunks.end())
-                        chunk->WestNeighbor = it->second;
-                    chunk->meshBuildQueued.store(true);
-                    _meshingPool->enqueue([this, chunk] {
-                        chunk->BuildMesh();
-                        if (!chunk->requiresRemesh.load())
-                            _meshUploadQueue.push(chunk);
-                    });
-                    //meshUploadQueue.push(chunk);
-                }
-            }
-            else {
-                //If chunk is nullptr, create the chunk and add it's generation to the generation ThreadPool
-                _worldChunks[position] = new Chunk();
-                Chunk* newChunk = _worldChunks[position];
-                newChunk->position = position;
-                _generationPool->enqueue([newChunk] {
-                    newChunk->Generate();
-                    });
-            }
+    if (CompactBudgetBytes > 0 && _meshArena.Allocator().Fragmentation() > CompactFragmentation)
+        _meshArena.Compact((uint32_t)(CompactBudgetBytes / sizeof(Vertex)));
+    UpdateView(glm::ivec2(std::floor(playerPosition.x / 16.0f), std::floor(playerPosition.y / 16.0f)));
+    ProcessPendingLoads();
+    ProcessMeshRequests();
+
+    _drawCandidates.clear();
+    _drawBoxes.Clear();
+    for (const glm::ivec2& offset : _scanOffsets) {
+        Chunk* chunk = _worldChunks.Find(_scanCenter + offset);
+        //render the chunk once it has had a mesh uploaded, the old mesh stays on screen while a new one builds
+        if (!chunk || !chunk->HasMesh())
+            continue;
+        glm::vec3 min, max;
+        chunk->GetBounds(min, max);
+        _drawCandidates.push_back(chunk);
+        _drawBoxes.Add(min, max);
+    }
+    //every box is tested in one batch, most of the chunks behind the player are dropped here
+    if (FrustumCulling)
+        Frustum::FromMatrix(projection * _player->GetView()).CullBoxes(_drawBoxes, _drawVisible);
+    else
+        _drawVisible.assign(_drawCandidates.size(), 1);
+    _draws.Clear();
+    for (size_t i = 0; i < _drawCandidates.size(); i++) {
+        if (_drawVisible[i])
+            _drawCandidates[i]->AppendDraws(_draws, _meshArena, cameraPosition);
+    }
+    //every visible chunk in one call
+    _meshArena.Draw(_draws);
+}
+
+void ChunkManager::UpdateView(const glm::ivec2& center) {
+    int unloadRadius = RenderDistance + UnloadMargin;
+    if (_scanRadius != RenderDistance) {
+        BuildScanOffsets();
+        //everything inside the unload disk, plus a quarter again for unloaded chunks still waiting on jobs before they return
+        _chunkPool.SetCapacity(_unloadOffsets.size() + _unloadOffsets.size() / 4);
+        //only happens when the render distance changes, so checking every loaded chunk is fine
+        std::vector<Chunk*> outside;
+        _worldChunks.ForEach([&](const glm::ivec2& position, Chunk* chunk) {
+            if (DistanceSquared(position, center) > unloadRadius * unloadRadius)
+                outside.push_back(chunk);
+        });
+        for (Chunk* chunk : outside)
+            UnloadChunk(chunk);
+        _pendingLoads.clear();
+        for (const glm::ivec2& offset : _scanOffsets)
+            _pendingLoads.push_back(center + offset);
+    }
+    else if (center != _scanCenter) {
+        //chunks that were inside the unload disk around the old center but are outside the one around the new center
+        for (const glm::ivec2& offset : _unloadOffsets) {
+            glm::ivec2 position = _scanCenter + offset;
+            if (DistanceSquared(position, center) <= unloadRadius * unloadRadius)
+                continue;
+            if (Chunk* chunk = _worldChunks.Find(position))
+                UnloadChunk(chunk);
         }
-        if (x == y || (x < 0 && x == -y) || (x > 0 && x == 1 - y)) {
-            int temp = dx;
-            dx = -dy;
-            dy = temp;
+        //chunks that are inside the view disk around the new center but weren't around the old one, nearest first
+        for (const glm::ivec2& offset : _scanOffsets) {
+            glm::ivec2 position = center + offset;
+            if (DistanceSquared(position, _scanCenter) > RenderDistance * RenderDistance)
+                _pendingLoads.push_back(position);
         }
-        x += dx;
-        y += dy;
     }
+    _scanCenter = center;
 }
 
-void ChunkManager::CheckChunksForDeletion(const glm::vec3& playerPosition) {
-    {
-        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+void ChunkManager::ProcessPendingLoads() {
+    int scheduled = 0;
+    while (!_pendingLoads.empty() && scheduled < MaxJobsPerFrame) {
+        glm::ivec2 position = _pendingLoads.front();
+        _pendingLoads.pop_front();
+        //the player may have moved on since the position was queued
+        if (DistanceSquared(position, _scanCenter) > RenderDistance * RenderDistance)
+            continue;
+        if (Chunk* chunk = _worldChunks.Find(position)) {
+            //already loaded in the margin outside the view, it may have been waiting to come into range to mesh
+            TryScheduleMesh(chunk);
+            continue;
+        }
+        Chunk* newChunk = _chunkPool.Acquire(position);
+        _worldChunks.Insert(position, newChunk);
+        _generationScheduler->Schedule(newChunk, [this, chunk = ChunkRef(newChunk)] {
+            chunk->Generate();
+            if (chunk->IsGenerated())
+                RequestMesh(chunk);
+            });
+        scheduled++;
     }
-    std::vector<std::pair<glm::ivec2, Chunk*>> pairs;
-    //minize lock time, get snapshot of valid keys
+}
+
+void ChunkManager::ProcessMeshRequests() {
+    //swapped with a member buffer so both keep their capacity from frame to frame
+    std::vector<ChunkRef>& requests = _meshRequestsProcessing;
     {
-        std::lock_guard<std::mutex> lock(_worldChunksMutex);
-        if (_worldChunks.empty()) 
-            return;
-        pairs.reserve(_worldChunks.size());
-        for (const auto& pair : _worldChunks)
-            pairs.push_back(pair);
+        std::lock_guard<std::mutex> lock(_meshRequestMutex);
+        requests.swap(_meshRequests);
     }
-    for (const auto& pair : pairs) {
-        Chunk* chunk = pair.second;
-        if (!chunk)
+    for (const ChunkRef& chunk : requests) {
+        //unloaded since the request was made, the reference only kept it alive until now
+        if (chunk->GetState() == ChunkState::Unloading)
             continue;
-        //don't queue the chunk if it was already scheduled, or if it hasn't finished loading
-        if (chunk->scheduledForDeletion.load() || !chunk->uploadComplete.load())
-            continue;
-        if (glm::distance(chunk->position, glm::vec2(playerPosition / 16.0f)) > RenderDistance + 2) {
-            chunk->scheduledForDeletion.store(true);
-            std::lock_guard<std::mutex> lock(_cleanupMutex);
-            _cleanupQueue.push_back(chunk);
+        TryScheduleMesh(chunk.Get());
+        //a chunk finishing generation may have been a missing neighbor of the chunks around it
+        for (int side = 0; side < 4; side++) {
+            Chunk* neighbor = _worldChunks.Find(glm::ivec2(chunk->position) + SideOffsets[side]);
+            if (!neighbor)
+                continue;
+            //the neighbor sees this chunk on its opposite side
+            if (neighbor->IsGenerated())
+                neighbor->PatchBorder(Opposite(ChunkSide(side)), *chunk.Get());
+            TryScheduleMesh(neighbor);
         }
     }
-    clearingChunks.store(false);
+    requests.clear();
+}
+
+void ChunkManager::RequestMesh(const ChunkRef& chunk) {
+    std::lock_guard<std::mutex> lock(_meshRequestMutex);
+    _meshRequests.push_back(chunk);
+}
+
+void ChunkManager::TryScheduleMesh(Chunk* chunk) {
+    ChunkState state = chunk->GetState();
+    if ((state != ChunkState::Generated && state != ChunkState::Uploaded) || !chunk->NeedsMesh())
+        return;
+    //chunks in the margin outside the view are kept loaded but not meshed
+    glm::ivec2 position(chunk->position);
+    if (DistanceSquared(position, _scanCenter) > RenderDistance * RenderDistance)
+        return;
+    //Face culling reads the neighbors' border columns. Neighbors that aren't generated are either waited for
+    //or stood in for by solid columns, either way their generation finishing requests this chunk again
+    const Chunk* neighbors[4];
+    bool complete = true;
+    for (int side = 0; side < 4; side++) {
+        Chunk* neighbor = _worldChunks.Find(position + SideOffsets[side]);
+        neighbors[side] = neighbor && neighbor->IsGenerated() ? neighbor : nullptr;
+        complete &= neighbors[side] != nullptr;
+    }
+    if (!complete && !MeshWithoutNeighbors)
+        return;
+    if (!chunk->TryTransition(state, ChunkState::Meshing))
+        return;
+    //the worker only reads the snapshot, so edits and neighbors unloading can't change what it sees
+    chunk->TakeSnapshot(neighbors[0], neighbors[1], neighbors[2], neighbors[3]);
+    _meshingScheduler->Schedule(chunk, [this, chunk = ChunkRef(chunk), mode = MeshMode] {
+        MeshResult result{ chunk, chunk->BuildMesh(_stagingRing, mode) };
+        //only waits if more chunks are meshing at once than the queue holds
+        while (!_meshResults.TryPush(std::move(result)))
+            std::this_thread::yield();
+    });
+}
+
+void ChunkManager::UnloadChunk(Chunk* chunk) {
+    //removed from the map right away so the position can load again, the chunk itself lives on in cleanup until it's unreferenced
+    _worldChunks.Erase(glm::ivec2(chunk->position));
+    chunk->MarkUnloading();
+    //drops the references held by jobs that haven't started, no new ones are scheduled once the chunk is unloading
+    _generationScheduler->Cancel(chunk);
+    _meshingScheduler->Cancel(chunk);
+    _cleanupQueue.push_back(chunk);
+}
+
+void ChunkManager::BuildScanOffsets() {
+    auto buildDisk = [](std::vector<glm::ivec2>& offsets, int radius) {
+        offsets.clear();
+        for (int x = -radius; x <= radius; x++) {
+            for (int y = -radius; y <= radius; y++) {
+                if (x * x + y * y <= radius * radius)
+                    offsets.emplace_back(x, y);
+            }
+        }
+        //nearest first, ties broken by coordinate so the order is the same every rebuild
+        std::sort(offsets.begin(), offsets.end(), [](const glm::ivec2& a, const glm::ivec2& b) {
+            int distanceA = a.x * a.x + a.y * a.y;
+            int distanceB = b.x * b.x + b.y * b.y;
+            if (distanceA != distanceB)
+                return distanceA < distanceB;
+            return a.x != b.x ? a.x < b.x : a.y < b.y;
+        });
+    };
+    buildDisk(_scanOffsets, RenderDistance);
+    buildDisk(_unloadOffsets, RenderDistance + UnloadMargin);
+    _scanRadius = RenderDistance;
 }
 
 void ChunkManager::ProcessChunkCleanup() {
-    std::lock_guard<std::mutex> lock(_cleanupMutex);
+    size_t kept = 0;
     for (Chunk* chunk : _cleanupQueue) {
-        _worldChunks.erase(chunk->position);
-        delete chunk;
+        //still pinned by a running job, a queued request or a mesh result
+        if (chunk->references.load(std::memory_order_acquire) > 0) {
+            _cleanupQueue[kept++] = chunk;
+            continue;
+        }
+        chunk->FreeMesh(_meshArena, _stagingRing);
+        _chunkPool.Release(chunk);
     }
-    _cleanupQueue.clear();
+    _cleanupQueue.resize(kept);
 }
 
 void ChunkManager::ProcessMeshUpload() {
-    int numUploads = 0;
-    while (_meshUploadQueue.size() > 0) {
-        Chunk* chunk = _meshUploadQueue.front();
-        _meshUploadQueue.pop();
-        chunk->UploadToGPU();
-        chunk->uploadComplete.store(true);
-        numUploads++;
-        if (numUploads >= maxUploadsPerFrame)
-            break;
+    //space the gpu is done copying out of comes back before this frame's results are taken
+    _stagingRing.Retire();
+    size_t uploadedBytes = 0;
+    MeshResult result;
+    while (uploadedBytes < UploadBudgetBytes && _meshResults.TryPop(result)) {
+        ChunkRef chunk = std::move(result.chunk);
+        //the build released its snapshot before handing over the result, edits can change the sections in place again
+        chunk->sharedSections = 0;
+        //an edit landed after the snapshot was taken, the mesh is missing it.
+        //The sections it staged are rebuilt along with the edited ones from a new snapshot
+        if (result.build.version != chunk->editVersion) {
+            chunk->dirtySections.fetch_or(chunk->stagingSections);
+            chunk->ReleaseStaging(_stagingRing);
+            if (chunk->TryTransition(ChunkState::Meshing, ChunkState::Generated))
+                TryScheduleMesh(chunk.Get());
+            continue;
+        }
+        //fails if the chunk was unloaded while its result waited, its staging is released along with its mesh
+        if (!chunk->TryTransition(ChunkState::Meshing, ChunkState::Uploaded))
+            continue;
+        chunk->UploadToGPU(_meshArena, _stagingRing);
+        if (!result.build.inRing)
+            uploadedBytes += result.build.bytes;
+        //a neighbor arriving while the build was in flight dirtied the sections its border exposes
+        TryScheduleMesh(chunk.Get());
     }
+    //fences the copies out of the ring recorded above
+    _stagingRing.Submit();
+}
+
+void ChunkManager::Initialize() {
+    //not in the constructor, which runs before there is a gl context
+    _stagingRing.Create(StagingRingBytes);
 }
 
 void ChunkManager::Terminate() {
-    _worldUpdatePool->join();
     _meshingPool->join();
     _generationPool->join();
+    //chunkManager outlives the gl context, so the gl objects go here rather than in the destructors
+    _meshArena.Destroy();
+    _stagingRing.Destroy();
 }
 
 int ChunkManager::GetGlobalBlock(const glm::ivec3& position) {
@@ -172,11 +297,8 @@ int ChunkManager::GetGlobalBlock(const glm::ivec3& position) {
 
     if (position.z < 0 || position.z > 255) 
         return 0;
-    glm::ivec2 chunkPos(chunkX, chunkY);
-    if (!_worldChunks.count(chunkPos))
-        return 0;
-    Chunk* chunk = _worldChunks[chunkPos];
-    if (!chunk->generated.load())
+    Chunk* chunk = _worldChunks.Find(glm::ivec2(chunkX, chunkY));
+    if (!chunk || !chunk->IsGenerated())
         return 0;
     int x = position.x % 16;
     if (x < 0)
@@ -187,16 +309,41 @@ int ChunkManager::GetGlobalBlock(const glm::ivec3& position) {
     return chunk->GetBlock(x, y, position.z);
 }
 
+int ChunkManager::GetSurfaceHeight(int x, int y) {
+    int chunkX = static_cast<int>(std::floor(x / 16.0f));
+    int chunkY = static_cast<int>(std::floor(y / 16.0f));
+    Chunk* chunk = _worldChunks.Find(glm::ivec2(chunkX, chunkY));
+    if (!chunk || !chunk->IsGenerated())
+        return -1;
+    int localX = x % 16;
+    if (localX < 0)
+        localX += 16;
+    int localY = y % 16;
+    if (localY < 0)
+        localY += 16;
+    return chunk->GetHeight(localX, localY);
+}
+
+ChunkManager::MemoryStats ChunkManager::GetMemoryStats() const {
+    MemoryStats stats;
+    _worldChunks.ForEach([&](const glm::ivec2&, Chunk* chunk) {
+        stats.chunks++;
+        stats.cpuBytes += chunk->CpuBytes();
+        stats.meshBytes += chunk->GpuBytes();
+        stats.vertices += chunk->meshOffsets[Chunk::RangeCount];
+    });
+    stats.gpuBytes = _meshArena.GpuBytes() + _stagingRing.Capacity();
+    return stats;
+}
+
 bool ChunkManager::TryBreakBlock(const glm::ivec3& position, bool forceUpdate) {
     int chunkX = static_cast<int>(std::floor(position.x / 16.0f));
     int chunkY = static_cast<int>(std::floor(position.y / 16.0f));
     if (position.z < 0 || position.z > 255)
         return 0;
     glm::ivec2 chunkPos(chunkX, chunkY);
-    if (!_worldChunks.count(chunkPos))
-        return false;
-    Chunk* chunk = _worldChunks[chunkPos];
-    if (!chunk->generated.load())
+    Chunk* chunk = _worldChunks.Find(chunkPos);
+    if (!chunk || !chunk->IsGenerated())
         return false;
     int x = position.x % 16;
     if (x < 0)
@@ -208,6 +355,24 @@ bool ChunkManager::TryBreakBlock(const glm::ivec3& position, bool forceUpdate) {
     if (blockID == 0)
         return false;
     chunk->SetBlock(x, y, position.z, 0);
-    chunk->requiresRemesh.store(true);
+    chunk->MarkSectionsDirty(position.z);
+    //the neighbors marked below are checked along with the chunk when the request is processed
+    RequestMesh(ChunkRef(chunk));
+    //blocks on the chunk border also cull faces in the neighboring chunk's mesh
+    if (x == 0)
+        MarkNeighborSectionDirty(chunkPos + glm::ivec2(-1, 0), position.z);
+    else if (x == 15)
+        MarkNeighborSectionDirty(chunkPos + glm::ivec2(1, 0), position.z);
+    if (y == 0)
+        MarkNeighborSectionDirty(chunkPos + glm::ivec2(0, -1), position.z);
+    else if (y == 15)
+        MarkNeighborSectionDirty(chunkPos + glm::ivec2(0, 1), position.z);
     return true;
+}
+
+void ChunkManager::MarkNeighborSectionDirty(const glm::ivec2& chunkPos, int z) {
+    Chunk* chunk = _worldChunks.Find(chunkPos);
+    if (!chunk || !chunk->IsGenerated())
+        return;
+    chunk->MarkSectionDirty(z >> 4);
 }
\ No newline at end of file
@@ -1,9 +1,16 @@
 #pragma once
-#include "Thread/ThreadPool.h"
+#include "Thread/JobSystem.h"
+#include "Thread/MPSCQueue.h"
 #include "World/Chunk.h"
+#include "World/ChunkScheduler.h"
+#include "World/ChunkMap.h"
+#include "World/ChunkPool.h"
+#include "World/MeshArena.h"
+#include "World/Frustum.h"
 #include <glm/glm.hpp>
 #include "OpenGL/Shader.h"
 #include <memory>
+#include <deque>
 
 //Forward declaration because circular dependencies are a bitch
 class Player;
@@ -11,31 +18,186 @@ class Player;
 class ChunkManager {
 public:
 	int RenderDistance = 12;
-	int MaxUploadsPerFrame = 10;
-	ChunkManager(std::shared_ptr<Player> player);
-	void Update(Shader& blockShader);
+	/// <summary>
+	/// Bytes of finished meshes uploaded from the cpu per frame, the rest wait for the following frames.
+	/// Only meshes that didn't fit in the staging ring count, copies out of the ring cost the main thread next to nothing.
+	/// A mesh that starts inside the budget is uploaded whole, so at least one goes up every frame.
+	/// </summary>
+	size_t UploadBudgetBytes = 2 * 1024 * 1024;
+	/// <summary>
+	/// Size of the staging ring meshing workers write finished meshes into, read when Initialize creates the ring.
+	/// It has to hold every mesh built but not yet copied out, plus the last couple of frames' worth the gpu may still be reading.
+	/// </summary>
+	size_t StagingRingBytes = 16 * 1024 * 1024;
+	/// <summary>
+	/// Bytes of chunk meshes the mesh arena may move per frame to close the holes unloaded chunks leave, 0 disables compaction.
+	/// Compaction only runs while the arena's fragmentation is above CompactFragmentation.
+	/// </summary>
+	size_t CompactBudgetBytes = 512 * 1024;
+	float CompactFragmentation = 0.5f;
+	/// <summary>
+	/// Most chunks Update starts loading in one frame, the rest are picked up over the following frames
+	/// </summary>
+	int MaxJobsPerFrame = 64;
+	/// <summary>
+	/// Chunks stay loaded until they are this many chunks beyond RenderDistance, so walking back and forth over a chunk border doesn't reload them
+	/// </summary>
+	int UnloadMargin = 2;
+	MeshingMode MeshMode = MeshingMode::Greedy;
+	/// <summary>
+	/// Mesh a chunk as soon as it is generated, treating neighbors that aren't yet as solid and patching the border faces in when they arrive.
+	/// When false a chunk waits for all four neighbors, so the edge of the view shows up a ring late.
+	/// </summary>
+	bool MeshWithoutNeighbors = true;
+	/// <summary>
+	/// Skip chunks whose mesh box is outside the view frustum
+	/// </summary>
+	bool FrustumCulling = true;
+	/// <summary>
+	/// Thread counts of 0 default to the hardware concurrency of the machine
+	/// </summary>
+	ChunkManager(std::shared_ptr<Player> player, unsigned int generationThreads = 0, unsigned int meshingThreads = 0);
+	/// <summary>
+	/// Loads, meshes and draws the chunks around the player. projection is the block shader's, combined with the player's view for culling.
+	/// </summary>
+	void Update(Shader& blockShader, const glm::mat4& projection);
+	/// <summary>
+	/// Creates the staging ring, call it once after the gl functions are loaded.
+	/// If the ring can't be created the meshes go through the staging vectors instead.
+	/// </summary>
+	void Initialize();
+	/// <summary>
+	/// Joins the worker pools and deletes the GL objects, call it before the context is destroyed
+	/// </summary>
 	void Terminate();
 	int GetGlobalBlock(const glm::ivec3& position);
+	/// <summary>
+	/// Z of the highest non air block at world column (x, y), or -1 if the column is empty or not loaded.
+	/// </summary>
+	int GetSurfaceHeight(int x, int y);
 	bool TryBreakBlock(const glm::ivec3& position, bool forceUpdate);
-	std::atomic<bool> clearingChunks{ false };
-private:
-	struct IVec2Hash {
-		size_t operator()(const glm::ivec2& v) const noexcept {
-			return (std::hash<int>()(v.x) ^ (std::hash<int>()(v.y) << 1));
-		}
+	/// <summary>
+	/// Allocation counters of the chunk pool. Once the view has loaded, allocated should stop growing while flying around.
+	/// </summary>
+	const ChunkPool::Stats& GetChunkPoolStats() const {
+		return _chunkPool.GetStats();
+	}
+	struct MemoryStats {
+		/// <summary>
+		/// Loaded chunks
+		/// </summary>
+		size_t chunks = 0;
+		/// <summary>
+		/// Sum of Chunk::CpuBytes over the loaded chunks
+		/// </summary>
+		size_t cpuBytes = 0;
+		/// <summary>
+		/// Everything the mesh arena and the staging ring have allocated on the gpu, including the free space in the arena buffer
+		/// </summary>
+		size_t gpuBytes = 0;
+		/// <summary>
+		/// Sum of Chunk::GpuBytes over the loaded chunks, the part of the arena handed out to them
+		/// </summary>
+		size_t meshBytes = 0;
+		/// <summary>
+		/// Vertices in the uploaded meshes, meshBytes minus this times sizeof(Vertex) is the headroom left for edits
+		/// </summary>
+		size_t vertices = 0;
 	};
-	std::unordered_map<glm::ivec2, Chunk*, IVec2Hash> _worldChunks;
+	/// <summary>
+	/// Occupancy and fragmentation of the mesh arena, in vertices
+	/// </summary>
+	ArenaAllocator::Stats GetMeshArenaStats() const {
+		return _meshArena.Allocator().GetStats();
+	}
+	/// <summary>
+	/// Occupancy of the staging ring, failed counts the meshes that fell back to an upload from the cpu
+	/// </summary>
+	StagingRing::Stats GetStagingRingStats() const {
+		return _stagingRing.GetStats();
+	}
+	/// <summary>
+	/// Walks the loaded chunks and totals their memory. Main thread only.
+	/// </summary>
+	MemoryStats GetMemoryStats() const;
+private:
+	ChunkMap _worldChunks;
+	ChunkPool _chunkPool;
+	MeshArena _meshArena;
+	/// <summary>
+	/// Draws of the current frame, kept so its storage is reused
+	/// </summary>
+	DrawCommandBuilder _draws;
+	/// <summary>
+	/// Meshed chunks in range this frame, nearest first, with their boxes and whether the frustum culling kept them
+	/// </summary>
+	std::vector<Chunk*> _drawCandidates;
+	BoxBatch _drawBoxes;
+	std::vector<uint8_t> _drawVisible;
 	std::shared_ptr<Player> _player;
-	std::unique_ptr<ThreadPool> _generationPool;
-	std::unique_ptr<ThreadPool> _meshingPool;
-	std::unique_ptr<ThreadPool> _worldUpdatePool;
-	const int maxUploadsPerFrame = 5;
-	std::mutex _cleanupMutex;
-	std::mutex _worldChunksMutex;
+	//Everything the worker jobs touch is declared above the pools. Members are destroyed in reverse order,
+	//so the pool threads are joined before any of it goes, even if Terminate was never called.
+	StagingRing _stagingRing{ std::make_unique<GLStagingBackend>() };
+	std::mutex _meshRequestMutex;
+	/// <summary>
+	/// A finished mesh build waiting to be uploaded
+	/// </summary>
+	struct MeshResult {
+		ChunkRef chunk;
+		MeshBuild build;
+	};
+	/// <summary>
+	/// Pushed by meshing workers, drained by the render thread. A chunk has at most one result in flight.
+	/// </summary>
+	MPSCQueue<MeshResult> _meshResults{ 4096 };
+	/// <summary>
+	/// Chunks to check for a mesh build on the next Update, pushed by finished jobs and block edits
+	/// </summary>
+	std::vector<ChunkRef> _meshRequests;
+	std::unique_ptr<ChunkScheduler> _generationScheduler;
+	std::unique_ptr<ChunkScheduler> _meshingScheduler;
+	std::unique_ptr<JobSystem> _generationPool;
+	std::unique_ptr<JobSystem> _meshingPool;
+	/// <summary>
+	/// Unloaded chunks waiting for their last reference to go before they're deleted
+	/// </summary>
 	std::vector<Chunk*> _cleanupQueue;
-	std::queue<Chunk*> _meshUploadQueue;
+	/// <summary>
+	/// _meshRequests swapped out by ProcessMeshRequests, so workers can keep pushing while it runs
+	/// </summary>
+	std::vector<ChunkRef> _meshRequestsProcessing;
+	/// <summary>
+	/// Positions that entered the view and still need a chunk created, nearest first per crossing
+	/// </summary>
+	std::deque<glm::ivec2> _pendingLoads;
+	/// <summary>
+	/// Chunk offsets within RenderDistance of the player, sorted nearest first. Rebuilt when RenderDistance changes.
+	/// </summary>
+	std::vector<glm::ivec2> _scanOffsets;
+	/// <summary>
+	/// Same as _scanOffsets out to RenderDistance + UnloadMargin
+	/// </summary>
+	std::vector<glm::ivec2> _unloadOffsets;
+	int _scanRadius = -1;
+	/// <summary>
+	/// Chunk the player was in on the last Update
+	/// </summary>
+	glm::ivec2 _scanCenter = glm::ivec2(0);
 
-	void CheckChunksForDeletion(const glm::vec3& playerPosition);
+	/// <summary>
+	/// Loads and unloads only the chunks that entered or left the view since the player's chunk last changed
+	/// </summary>
+	void UpdateView(const glm::ivec2& center);
+	void BuildScanOffsets();
+	void ProcessPendingLoads();
+	void ProcessMeshRequests();
+	/// <summary>
+	/// Thread safe, the chunk is checked on the main thread during the next Update
+	/// </summary>
+	void RequestMesh(const ChunkRef& chunk);
+	void TryScheduleMesh(Chunk* chunk);
+	void UnloadChunk(Chunk* chunk);
 	void ProcessChunkCleanup();
 	void ProcessMeshUpload();
+	void MarkNeighborSectionDirty(const glm::ivec2& chunkPos, int z);
 };
\ No newline at end of file
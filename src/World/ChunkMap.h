@@ -0,0 +1,129 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+struct Chunk;
+
+/// <summary>
+/// Open addressing hash map from chunk coordinate to chunk, replacing std::unordered_map for the world chunk index.
+/// Slots live in one flat array probed linearly, so a lookup is a hash and usually a single cache line.
+/// Removal shifts the following entries back instead of leaving tombstones, so probe chains stay short as chunks stream in and out.
+/// A null chunk marks an empty slot, null can't be stored.
+/// </summary>
+class ChunkMap {
+public:
+	struct Slot {
+		glm::ivec2 position = glm::ivec2(0);
+		Chunk* chunk = nullptr;
+	};
+
+	ChunkMap(size_t capacity = 64) {
+		size_t size = 16;
+		while (size < capacity * 2)
+			size <<= 1;
+		_slots.resize(size);
+		_mask = size - 1;
+	}
+	/// <summary>
+	/// The chunk at position, or nullptr if none is loaded there
+	/// </summary>
+	inline Chunk* Find(const glm::ivec2& position) const noexcept {
+		for (size_t i = Hash(position) & _mask;; i = (i + 1) & _mask) {
+			const Slot& slot = _slots[i];
+			if (!slot.chunk)
+				return nullptr;
+			if (slot.position == position)
+				return slot.chunk;
+		}
+	}
+	/// <summary>
+	/// Adds or replaces the chunk at position
+	/// </summary>
+	void Insert(const glm::ivec2& position, Chunk* chunk) {
+		if ((_count + 1) * 4 > _slots.size() * 3)
+			Rehash(_slots.size() * 2);
+		for (size_t i = Hash(position) & _mask;; i = (i + 1) & _mask) {
+			Slot& slot = _slots[i];
+			if (!slot.chunk) {
+				slot.position = position;
+				slot.chunk = chunk;
+				_count++;
+				return;
+			}
+			if (slot.position == position) {
+				slot.chunk = chunk;
+				return;
+			}
+		}
+	}
+	/// <summary>
+	/// Removes the chunk at position, returns false if there wasn't one
+	/// </summary>
+	bool Erase(const glm::ivec2& position) {
+		size_t i = Hash(position) & _mask;
+		for (;; i = (i + 1) & _mask) {
+			if (!_slots[i].chunk)
+				return false;
+			if (_slots[i].position == position)
+				break;
+		}
+		//pull back any later entry in the run whose home slot is at or before the hole, so lookups never hit a gap
+		for (size_t next = (i + 1) & _mask;; next = (next + 1) & _mask) {
+			Slot& slot = _slots[next];
+			if (!slot.chunk)
+				break;
+			size_t home = Hash(slot.position) & _mask;
+			if (((next - home) & _mask) >= ((next - i) & _mask)) {
+				_slots[i] = slot;
+				i = next;
+			}
+		}
+		_slots[i] = Slot();
+		_count--;
+		return true;
+	}
+	size_t Size() const noexcept {
+		return _count;
+	}
+	bool Empty() const noexcept {
+		return _count == 0;
+	}
+	/// <summary>
+	/// Calls f(position, chunk) for every loaded chunk, in no particular order. The map must not be modified inside f.
+	/// </summary>
+	template<typename F>
+	void ForEach(F&& f) const {
+		for (const Slot& slot : _slots)
+			if (slot.chunk)
+				f(slot.position, slot.chunk);
+	}
+private:
+	std::vector<Slot> _slots;
+	size_t _mask = 0;
+	size_t _count = 0;
+
+	/// <summary>
+	/// Packs both coordinates into 64 bits and runs the splitmix64 finalizer over them,
+	/// so neighboring and diagonal coordinates land in unrelated slots
+	/// </summary>
+	static inline size_t Hash(const glm::ivec2& position) noexcept {
+		uint64_t key = (uint64_t)(uint32_t)position.x << 32 | (uint32_t)position.y;
+		key ^= key >> 30;
+		key *= 0xbf58476d1ce4e5b9ull;
+		key ^= key >> 27;
+		key *= 0x94d049bb133111ebull;
+		key ^= key >> 31;
+		return (size_t)key;
+	}
+	void Rehash(size_t size) {
+		std::vector<Slot> old(size);
+		old.swap(_slots);
+		_mask = size - 1;
+		_count = 0;
+		for (const Slot& slot : old)
+			if (slot.chunk)
+				Insert(slot.position, slot.chunk);
+	}
+};
@@ -0,0 +1,45 @@
+#include "World/ChunkPool.h"
+#include "World/Chunk.h"
+
+ChunkPool::~ChunkPool() {
+    for (Chunk* chunk : _free)
+        delete chunk;
+}
+
+Chunk* ChunkPool::Acquire(const glm::ivec2& position) {
+    Chunk* chunk;
+    if (_free.empty()) {
+        chunk = new Chunk();
+        _stats.allocated++;
+    }
+    else {
+        chunk = _free.back();
+        _free.pop_back();
+        _stats.recycled++;
+    }
+    chunk->position = position;
+    _stats.live++;
+    return chunk;
+}
+
+void ChunkPool::Release(Chunk* chunk) {
+    _stats.live--;
+    if (_stats.live + _free.size() >= _capacity) {
+        delete chunk;
+        _stats.freed++;
+        return;
+    }
+    chunk->Reset();
+    _free.push_back(chunk);
+}
+
+void ChunkPool::SetCapacity(size_t capacity) {
+    _capacity = capacity;
+    _free.reserve(capacity);
+    //drop free chunks past the new capacity, live chunks are dropped as they're released
+    while (!_free.empty() && _stats.live + _free.size() > _capacity) {
+        delete _free.back();
+        _free.pop_back();
+        _stats.freed++;
+    }
+}
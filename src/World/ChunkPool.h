@@ -0,0 +1,62 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstddef>
+
+struct Chunk;
+
+/// <summary>
+/// Recycles unloaded chunks for the next chunk that loads instead of freeing them.
+/// A recycled chunk keeps its block storage, so once the pool has warmed up loading and unloading chunks doesn't touch the heap.
+/// Its mesh goes back to the mesh arena before it's released. Only used from the main thread.
+/// </summary>
+class ChunkPool {
+public:
+	struct Stats {
+		/// <summary>
+		/// Chunks created with new because the pool was empty
+		/// </summary>
+		size_t allocated = 0;
+		/// <summary>
+		/// Chunks handed out again after being released
+		/// </summary>
+		size_t recycled = 0;
+		/// <summary>
+		/// Chunks deleted on release because the pool was already at capacity
+		/// </summary>
+		size_t freed = 0;
+		/// <summary>
+		/// Chunks currently handed out
+		/// </summary>
+		size_t live = 0;
+	};
+	ChunkPool() = default;
+	ChunkPool(const ChunkPool&) = delete;
+	ChunkPool& operator=(const ChunkPool&) = delete;
+	~ChunkPool();
+	/// <summary>
+	/// A chunk in the Queued state at position, recycled if one is free
+	/// </summary>
+	Chunk* Acquire(const glm::ivec2& position);
+	/// <summary>
+	/// Returns a chunk to the pool. Nothing may reference it anymore.
+	/// </summary>
+	void Release(Chunk* chunk);
+	/// <summary>
+	/// Most chunks kept alive at once, live and free together. Chunks released past it are deleted.
+	/// </summary>
+	void SetCapacity(size_t capacity);
+	size_t Capacity() const {
+		return _capacity;
+	}
+	size_t FreeCount() const {
+		return _free.size();
+	}
+	const Stats& GetStats() const {
+		return _stats;
+	}
+private:
+	std::vector<Chunk*> _free;
+	size_t _capacity = 0;
+	Stats _stats;
+};
@@ -0,0 +1,66 @@
+#include "World/ChunkScheduler.h"
+#include "World/Chunk.h"
+#include <algorithm>
+
+ChunkScheduler::ChunkScheduler(JobSystem& pool) : _pool(pool) {
+
+}
+
+void ChunkScheduler::SetView(const glm::vec2& center, const glm::vec3& front) {
+    glm::vec2 flatFront(front.x, front.y);
+    float length = glm::length(flatFront);
+    //looking straight up or down gives no useful direction, rank by distance only
+    flatFront = length > 0.1f ? flatFront / length : glm::vec2(0.0f);
+    std::lock_guard<std::mutex> lock(_mutex);
+    //small movements don't change the order enough to be worth resorting every waiting job
+    if (glm::distance(center, _center) < 0.25f && glm::dot(flatFront, _front) > 0.98f)
+        return;
+    _center = center;
+    _front = flatFront;
+    _viewChanged = true;
+}
+
+void ChunkScheduler::Cancel(const Chunk* chunk) {
+    //the pool still holds a dispatch for each removed job, those find nothing to run and return
+    std::lock_guard<std::mutex> lock(_mutex);
+    size_t count = _jobs.size();
+    _jobs.erase(std::remove_if(_jobs.begin(), _jobs.end(), [chunk](const Job& job) {
+        return job.chunk == chunk;
+    }), _jobs.end());
+    if (_jobs.size() != count)
+        std::make_heap(_jobs.begin(), _jobs.end(), JobOrder());
+}
+
+float ChunkScheduler::Priority(const Chunk* chunk) const {
+    glm::vec2 offset = chunk->position + 0.5f - _center;
+    float distance = glm::length(offset);
+    if (distance < 1.0f)
+        return distance;
+    //chunks straight ahead keep their distance, chunks directly behind count as twice as far
+    float facing = glm::dot(offset / distance, _front);
+    return distance * (1.5f - 0.5f * facing);
+}
+
+void ChunkScheduler::RunNext() {
+    Job job;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_viewChanged) {
+            for (Job& waiting : _jobs)
+                waiting.priority = Priority(waiting.chunk);
+            std::make_heap(_jobs.begin(), _jobs.end(), JobOrder());
+            _viewChanged = false;
+        }
+        for (;;) {
+            if (_jobs.empty())
+                return;
+            std::pop_heap(_jobs.begin(), _jobs.end(), JobOrder());
+            job = std::move(_jobs.back());
+            _jobs.pop_back();
+            //the player left the chunk behind while the job waited, skip it and take the next one
+            if (job.chunk->GetState() != ChunkState::Unloading)
+                break;
+        }
+    }
+    job.work();
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include "Thread/JobSystem.h"
+#include <glm/glm.hpp>
+#include <vector>
+#include <mutex>
+#include <algorithm>
+
+struct Chunk;
+
+/// <summary>
+/// Priority queue of chunk jobs in front of a JobSystem.
+/// Jobs are kept here instead of in the pool's queues. Every scheduled job dispatches one task to the pool,
+/// and that task runs whichever job is best when a worker picks it up, so priorities can change while jobs wait.
+/// Priority is distance to the player in chunks, scaled up for chunks away from where the camera is facing.
+/// Jobs whose chunk has been scheduled for deletion are dropped instead of run.
+/// </summary>
+class ChunkScheduler {
+public:
+	ChunkScheduler(JobSystem& pool);
+	/// <summary>
+	/// Updates the view used to prioritize jobs. center is the player position in chunk coordinates.
+	/// Waiting jobs are reprioritized by the next worker to take one, if the view moved enough to matter.
+	/// </summary>
+	void SetView(const glm::vec2& center, const glm::vec3& front);
+	template<typename F>
+	void Schedule(Chunk* chunk, F&& work) {
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_jobs.push_back(Job{ chunk, Priority(chunk), Task(std::forward<F>(work)) });
+			std::push_heap(_jobs.begin(), _jobs.end(), JobOrder());
+		}
+		_pool.enqueue([this] { RunNext(); });
+	}
+	/// <summary>
+	/// Removes every waiting job for the chunk. A job already running on it is left to finish, its chunk reference keeps the chunk alive until then.
+	/// </summary>
+	void Cancel(const Chunk* chunk);
+private:
+	struct Job {
+		Chunk* chunk = nullptr;
+		float priority = 0.0f;
+		Task work;
+	};
+	//std heap functions keep the largest element on top, so order by lowest priority value first
+	struct JobOrder {
+		bool operator()(const Job& a, const Job& b) const noexcept {
+			return a.priority > b.priority;
+		}
+	};
+	JobSystem& _pool;
+	std::mutex _mutex;
+	std::vector<Job> _jobs;
+	glm::vec2 _center = glm::vec2(0.0f);
+	glm::vec2 _front = glm::vec2(0.0f);
+	bool _viewChanged = false;
+
+	float Priority(const Chunk* chunk) const;
+	void RunNext();
+};
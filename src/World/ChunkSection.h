@@ -0,0 +1,55 @@
+#pragma once
+#include "World/PaletteStorage.h"
+
+/// <summary>
+/// A 16x16x16 vertical slice of a chunk.
+/// Sections that are all one block (including all air) keep a single palette entry and no index array.
+/// </summary>
+struct ChunkSection {
+	static constexpr int Size = 16;
+	/// <summary>
+	/// Block IDs, indexed x * 256 + y * 16 + z so each column is contiguous
+	/// </summary>
+	PaletteStorage blocks{ Size * Size * Size };
+	/// <summary>
+	/// Number of non air blocks in the section
+	/// </summary>
+	int solidCount = 0;
+
+	inline int GetBlock(int x, int y, int z) const noexcept {
+		return blocks.Get((x * Size + y) * Size + z);
+	}
+	inline void SetBlock(int x, int y, int z, int ID) {
+		size_t index = (x * Size + y) * Size + z;
+		int previous = blocks.Get(index);
+		if (previous == ID)
+			return;
+		solidCount += (ID != 0) - (previous != 0);
+		if (solidCount == 0)
+			blocks.Fill(0);
+		else
+			blocks.Set(index, ID);
+	}
+	/// <summary>
+	/// True if every block in the section is air
+	/// </summary>
+	inline bool IsEmpty() const noexcept {
+		return solidCount == 0;
+	}
+	/// <summary>
+	/// True if every block in the section has the same ID
+	/// </summary>
+	inline bool IsUniform() const noexcept {
+		return blocks.BitsPerIndex() == 0;
+	}
+	/// <summary>
+	/// True if every block in the section is the same non air block
+	/// </summary>
+	inline bool IsSolid() const noexcept {
+		return solidCount == Size * Size * Size;
+	}
+	void Fill(int ID) {
+		blocks.Fill(ID);
+		solidCount = ID == 0 ? 0 : Size * Size * Size;
+	}
+};
@@ -0,0 +1,167 @@
+#pragma once
+#include <cstdint>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+/// <summary>
+/// Index of the lowest set bit, word must be non zero
+/// </summary>
+inline int LowestSetBit(uint64_t word) noexcept {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+	unsigned long index;
+	_BitScanForward64(&index, word);
+	return (int)index;
+#elif defined(_MSC_VER)
+	//the 64 bit scans only exist on 64 bit targets, Win32 scans each half
+	unsigned long index;
+	if (_BitScanForward(&index, (unsigned long)word))
+		return (int)index;
+	_BitScanForward(&index, (unsigned long)(word >> 32));
+	return (int)index + 32;
+#else
+	return __builtin_ctzll(word);
+#endif
+}
+
+/// <summary>
+/// Index of the highest set bit, word must be non zero
+/// </summary>
+inline int HighestSetBit(uint64_t word) noexcept {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+	unsigned long index;
+	_BitScanReverse64(&index, word);
+	return (int)index;
+#elif defined(_MSC_VER)
+	unsigned long index;
+	if (_BitScanReverse(&index, (unsigned long)(word >> 32)))
+		return (int)index + 32;
+	_BitScanReverse(&index, (unsigned long)word);
+	return (int)index;
+#else
+	return 63 - __builtin_clzll(word);
+#endif
+}
+
+/// <summary>
+/// 256 bit mask over one chunk column, bit z is set if the block at height z is opaque.
+/// </summary>
+struct ColumnMask {
+	static constexpr int WordCount = 4;
+	uint64_t words[WordCount] = { 0, 0, 0, 0 };
+
+	inline bool Test(int z) const noexcept {
+		return (words[z >> 6] >> (z & 63)) & 1;
+	}
+	inline void Set(int z) noexcept {
+		words[z >> 6] |= uint64_t(1) << (z & 63);
+	}
+	inline void Clear(int z) noexcept {
+		words[z >> 6] &= ~(uint64_t(1) << (z & 63));
+	}
+	/// <summary>
+	/// Sets bits [start, end)
+	/// </summary>
+	void SetRange(int start, int end) noexcept {
+		for (int i = 0; i < WordCount; i++) {
+			int lo = start - i * 64 < 0 ? 0 : start - i * 64;
+			int hi = end - i * 64 > 64 ? 64 : end - i * 64;
+			if (lo >= hi)
+				continue;
+			uint64_t bits = hi - lo == 64 ? ~uint64_t(0) : ((uint64_t(1) << (hi - lo)) - 1);
+			words[i] |= bits << lo;
+		}
+	}
+	/// <summary>
+	/// Mask with bits [start, end) set
+	/// </summary>
+	static ColumnMask Range(int start, int end) noexcept {
+		ColumnMask result;
+		result.SetRange(start, end);
+		return result;
+	}
+	void Reset() noexcept {
+		for (uint64_t& word : words)
+			word = 0;
+	}
+	inline bool Any() const noexcept {
+		return (words[0] | words[1] | words[2] | words[3]) != 0;
+	}
+	/// <summary>
+	/// Bit z of the result is bit z + 1 of this mask, the block above. The top bit shifts in 0 (sky).
+	/// </summary>
+	inline ColumnMask Above() const noexcept {
+		ColumnMask result;
+		for (int i = 0; i < WordCount - 1; i++)
+			result.words[i] = (words[i] >> 1) | (words[i + 1] << 63);
+		result.words[WordCount - 1] = words[WordCount - 1] >> 1;
+		return result;
+	}
+	/// <summary>
+	/// Bit z of the result is bit z - 1 of this mask, the block below. Bit 0 shifts in 0 (bottom of the world).
+	/// </summary>
+	inline ColumnMask Below() const noexcept {
+		ColumnMask result;
+		result.words[0] = words[0] << 1;
+		for (int i = 1; i < WordCount; i++)
+			result.words[i] = (words[i] << 1) | (words[i - 1] >> 63);
+		return result;
+	}
+	/// <summary>
+	/// this AND NOT other. With other as a neighbor's opacity, gives the faces that neighbor leaves exposed.
+	/// </summary>
+	inline ColumnMask AndNot(const ColumnMask& other) const noexcept {
+		ColumnMask result;
+		for (int i = 0; i < WordCount; i++)
+			result.words[i] = words[i] & ~other.words[i];
+		return result;
+	}
+	/// <summary>
+	/// Lowest set z, or -1 if the mask is empty
+	/// </summary>
+	inline int Lowest() const noexcept {
+		for (int i = 0; i < WordCount; i++)
+			if (words[i])
+				return i * 64 + LowestSetBit(words[i]);
+		return -1;
+	}
+	/// <summary>
+	/// Highest set z, or -1 if the mask is empty
+	/// </summary>
+	inline int Highest() const noexcept {
+		for (int i = WordCount - 1; i >= 0; i--)
+			if (words[i])
+				return i * 64 + HighestSetBit(words[i]);
+		return -1;
+	}
+	inline ColumnMask& operator|=(const ColumnMask& other) noexcept {
+		for (int i = 0; i < WordCount; i++)
+			words[i] |= other.words[i];
+		return *this;
+	}
+	inline ColumnMask operator&(const ColumnMask& other) const noexcept {
+		ColumnMask result;
+		for (int i = 0; i < WordCount; i++)
+			result.words[i] = words[i] & other.words[i];
+		return result;
+	}
+	inline ColumnMask operator|(const ColumnMask& other) const noexcept {
+		ColumnMask result;
+		for (int i = 0; i < WordCount; i++)
+			result.words[i] = words[i] | other.words[i];
+		return result;
+	}
+	/// <summary>
+	/// Calls f(z) for every set bit, lowest first
+	/// </summary>
+	template<typename F>
+	inline void ForEachSetBit(F&& f) const {
+		for (int i = 0; i < WordCount; i++) {
+			uint64_t word = words[i];
+			while (word) {
+				f(i * 64 + LowestSetBit(word));
+				word &= word - 1;
+			}
+		}
+	}
+};
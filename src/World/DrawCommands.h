@@ -0,0 +1,76 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+
+/// <summary>
+/// One draw of glMultiDrawElementsIndirect, laid out as GL reads it from the indirect buffer
+/// </summary>
+struct DrawElementsIndirectCommand {
+	uint32_t count;
+	uint32_t instanceCount;
+	uint32_t firstIndex;
+	int32_t baseVertex;
+	uint32_t baseInstance;
+};
+static_assert(sizeof(DrawElementsIndirectCommand) == 20, "GL reads indirect commands as 5 tightly packed uints");
+
+/// <summary>
+/// Collects the indirect draws of every visible chunk for one frame.
+/// Each chunk adds one chunk position, read in block.vert as a per instance attribute, and the draws of its visible ranges
+/// point at it through baseInstance. Ranges are in vertices of the quad mesh, drawn through the shared quad index buffer.
+/// </summary>
+class DrawCommandBuilder {
+public:
+	void Clear() {
+		_commands.clear();
+		_positions.clear();
+		_chunkOpen = false;
+	}
+	/// <summary>
+	/// Starts the draws of a chunk whose mesh starts at vertex baseVertex of the arena.
+	/// The chunk position is only added once one of its ranges is.
+	/// </summary>
+	void BeginChunk(const glm::ivec2& position, uint32_t baseVertex) {
+		_chunkPosition = position;
+		_baseVertex = baseVertex;
+		_chunkOpen = false;
+	}
+	/// <summary>
+	/// Adds a draw of vertexCount vertices from firstVertex of the current chunk's mesh, both multiples of 4
+	/// </summary>
+	void AddRange(uint32_t firstVertex, uint32_t vertexCount) {
+		if (vertexCount == 0)
+			return;
+		if (!_chunkOpen) {
+			_positions.push_back(_chunkPosition);
+			_chunkOpen = true;
+		}
+		DrawElementsIndirectCommand command;
+		//the shared index buffer repeats the same pattern, so quad n's indices always point at vertices 4n to 4n + 3
+		command.count = vertexCount / 4 * 6;
+		command.instanceCount = 1;
+		command.firstIndex = firstVertex / 4 * 6;
+		command.baseVertex = (int32_t)_baseVertex;
+		command.baseInstance = (uint32_t)_positions.size() - 1;
+		_commands.push_back(command);
+	}
+	const std::vector<DrawElementsIndirectCommand>& Commands() const noexcept {
+		return _commands;
+	}
+	/// <summary>
+	/// Chunk position of each chunk with a draw, indexed by baseInstance
+	/// </summary>
+	const std::vector<glm::ivec2>& Positions() const noexcept {
+		return _positions;
+	}
+	bool Empty() const noexcept {
+		return _commands.empty();
+	}
+private:
+	std::vector<DrawElementsIndirectCommand> _commands;
+	std::vector<glm::ivec2> _positions;
+	glm::ivec2 _chunkPosition = glm::ivec2(0);
+	uint32_t _baseVertex = 0;
+	bool _chunkOpen = false;
+};
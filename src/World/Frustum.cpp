@@ -0,0 +1,72 @@
+#include "World/Frustum.h"
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1) || defined(__SSE__)
+#define FRUSTUM_SSE
+#include <xmmintrin.h>
+#endif
+
+Frustum Frustum::FromMatrix(const glm::mat4& viewProjection) {
+    //glm is column major, row i of the matrix is m[0][i] to m[3][i]
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; i++)
+        rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+    //a clip space point is inside when -w <= x, y, z <= w, each side of that is one plane
+    Frustum frustum;
+    frustum.planes[0] = rows[3] + rows[0];
+    frustum.planes[1] = rows[3] - rows[0];
+    frustum.planes[2] = rows[3] + rows[1];
+    frustum.planes[3] = rows[3] - rows[1];
+    frustum.planes[4] = rows[3] + rows[2];
+    frustum.planes[5] = rows[3] - rows[2];
+    return frustum;
+}
+
+bool Frustum::IntersectsBox(const glm::vec3& min, const glm::vec3& max) const noexcept {
+    for (const glm::vec4& plane : planes) {
+        //the corner furthest along the plane's normal, if it's outside the whole box is
+        glm::vec3 corner(plane.x >= 0.0f ? max.x : min.x, plane.y >= 0.0f ? max.y : min.y, plane.z >= 0.0f ? max.z : min.z);
+        if (plane.w + plane.x * corner.x + plane.y * corner.y + plane.z * corner.z < 0.0f)
+            return false;
+    }
+    return true;
+}
+
+void Frustum::CullBoxes(const BoxBatch& boxes, std::vector<uint8_t>& visible) const {
+    size_t count = boxes.Size();
+    visible.resize(count);
+    //the corner furthest along each plane's normal takes the same side of every box, so the arrays to read are picked once per plane
+    const float* corners[6][3];
+    for (int p = 0; p < 6; p++) {
+        for (int axis = 0; axis < 3; axis++)
+            corners[p][axis] = planes[p][axis] >= 0.0f ? boxes.Max(axis) : boxes.Min(axis);
+    }
+    size_t i = 0;
+#ifdef FRUSTUM_SSE
+    __m128 normals[6][4];
+    for (int p = 0; p < 6; p++) {
+        for (int c = 0; c < 4; c++)
+            normals[p][c] = _mm_set1_ps(planes[p][c]);
+    }
+    const __m128 zero = _mm_setzero_ps();
+    for (; i + 4 <= count; i += 4) {
+        __m128 outside = zero;
+        for (int p = 0; p < 6; p++) {
+            __m128 distance = _mm_add_ps(_mm_mul_ps(normals[p][0], _mm_loadu_ps(corners[p][0] + i)), normals[p][3]);
+            distance = _mm_add_ps(distance, _mm_mul_ps(normals[p][1], _mm_loadu_ps(corners[p][1] + i)));
+            distance = _mm_add_ps(distance, _mm_mul_ps(normals[p][2], _mm_loadu_ps(corners[p][2] + i)));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, zero));
+        }
+        int mask = _mm_movemask_ps(outside);
+        for (int lane = 0; lane < 4; lane++)
+            visible[i + lane] = !((mask >> lane) & 1);
+    }
+#endif
+    //the boxes left over from the last group of four, or all of them without SSE
+    for (; i < count; i++) {
+        bool inside = true;
+        for (int p = 0; p < 6 && inside; p++) {
+            const glm::vec4& plane = planes[p];
+            inside = plane.w + plane.x * corners[p][0][i] + plane.y * corners[p][1][i] + plane.z * corners[p][2][i] >= 0.0f;
+        }
+        visible[i] = inside;
+    }
+}
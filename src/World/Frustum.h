@@ -0,0 +1,66 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/// <summary>
+/// Axis aligned boxes stored as one array per coordinate, so Frustum::CullBoxes can load four of them at a time
+/// </summary>
+class BoxBatch {
+public:
+	void Clear() {
+		for (std::vector<float>& coordinate : _coordinates)
+			coordinate.clear();
+	}
+	void Add(const glm::vec3& min, const glm::vec3& max) {
+		_coordinates[0].push_back(min.x);
+		_coordinates[1].push_back(min.y);
+		_coordinates[2].push_back(min.z);
+		_coordinates[3].push_back(max.x);
+		_coordinates[4].push_back(max.y);
+		_coordinates[5].push_back(max.z);
+	}
+	size_t Size() const noexcept {
+		return _coordinates[0].size();
+	}
+	/// <summary>
+	/// Component axis of every box's min corner
+	/// </summary>
+	const float* Min(int axis) const noexcept {
+		return _coordinates[axis].data();
+	}
+	const float* Max(int axis) const noexcept {
+		return _coordinates[3 + axis].data();
+	}
+private:
+	/// <summary>
+	/// min x, min y, min z, max x, max y, max z
+	/// </summary>
+	std::vector<float> _coordinates[6];
+};
+
+/// <summary>
+/// The six planes bounding what a projection * view matrix puts on screen, each with its normal pointing inwards.
+/// A point p is on the inside of plane n when dot(n.xyz, p) + n.w >= 0.
+/// </summary>
+struct Frustum {
+	/// <summary>
+	/// Left, right, bottom, top, near, far
+	/// </summary>
+	glm::vec4 planes[6];
+
+	/// <summary>
+	/// Planes of a gl clip space matrix, depth from -1 to 1. Not normalized, the tests only look at which side a point is on.
+	/// </summary>
+	static Frustum FromMatrix(const glm::mat4& viewProjection);
+	/// <summary>
+	/// False only if the box is entirely on the outside of one plane. Boxes just past a corner of the frustum still pass, which only costs a draw.
+	/// </summary>
+	bool IntersectsBox(const glm::vec3& min, const glm::vec3& max) const noexcept;
+	/// <summary>
+	/// Sets visible[i] to whether box i intersects the frustum, the same answer as IntersectsBox, four boxes at a time with SSE.
+	/// visible is resized to the batch.
+	/// </summary>
+	void CullBoxes(const BoxBatch& boxes, std::vector<uint8_t>& visible) const;
+};
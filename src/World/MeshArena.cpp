@@ -0,0 +1,159 @@
+#include "World/MeshArena.h"
+#include "World/Vertex.h"
+#include <algorithm>
+#include <vector>
+
+void MeshArena::Destroy() {
+    if (_vao == 0)
+        return;
+    glDeleteBuffers(1, &_vertexBuffer);
+    glDeleteBuffers(1, &_indexBuffer);
+    glDeleteBuffers(1, &_scratchBuffer);
+    glDeleteBuffers(1, &_commandBuffer);
+    glDeleteBuffers(1, &_positionBuffer);
+    glDeleteVertexArrays(1, &_vao);
+    _vao = _vertexBuffer = _indexBuffer = _scratchBuffer = _commandBuffer = _positionBuffer = 0;
+    _indexQuads = _scratchVertices = _commandBytes = _positionBytes = 0;
+}
+
+void MeshArena::CreateObjects() {
+    if (_vao != 0)
+        return;
+    glGenVertexArrays(1, &_vao);
+    glGenBuffers(1, &_vertexBuffer);
+    glGenBuffers(1, &_indexBuffer);
+    glGenBuffers(1, &_commandBuffer);
+    glGenBuffers(1, &_positionBuffer);
+    glBindVertexArray(_vao);
+
+    //packed vertex, unpacked in block.vert
+    glBindBuffer(GL_ARRAY_BUFFER, _vertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, InitialVertices * sizeof(Vertex), nullptr, GL_DYNAMIC_DRAW);
+    glVertexAttribIPointer(0, 1, GL_UNSIGNED_INT, sizeof(Vertex), (void*)0);
+    glEnableVertexAttribArray(0);
+
+    //chunk position, one per instance. Every draw is a single instance starting at its chunk's baseInstance
+    glBindBuffer(GL_ARRAY_BUFFER, _positionBuffer);
+    glVertexAttribIPointer(1, 2, GL_INT, sizeof(glm::ivec2), (void*)0);
+    glVertexAttribDivisor(1, 1);
+    glEnableVertexAttribArray(1);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indexBuffer);
+    glBindVertexArray(0);
+    _allocator.Grow(InitialVertices);
+}
+
+uint32_t MeshArena::Allocate(uint32_t vertices) {
+    CreateObjects();
+    uint32_t handle = _allocator.Allocate(vertices);
+    if (handle != ArenaAllocator::InvalidHandle)
+        return handle;
+    //the free space at the end merges with the new space, so the allocation always fits after growing
+    GrowVertexBuffer(std::max(_allocator.Capacity() * 2, _allocator.Capacity() + vertices));
+    return _allocator.Allocate(vertices);
+}
+
+void MeshArena::Free(uint32_t handle) {
+    _allocator.Free(handle);
+}
+
+void MeshArena::Compact(uint32_t maxVertices) {
+    _moves.clear();
+    if (_allocator.Compact(maxVertices, _moves) == 0)
+        return;
+    for (const ArenaAllocator::Move& move : _moves) {
+        size_t from = (size_t)move.from * sizeof(Vertex);
+        size_t to = (size_t)move.to * sizeof(Vertex);
+        size_t bytes = (size_t)move.size * sizeof(Vertex);
+        //glCopyBufferSubData can't copy between overlapping parts of one buffer, a short slide goes through the scratch buffer
+        if (move.to + move.size > move.from) {
+            GLuint scratch = ScratchBuffer(move.size);
+            glBindBuffer(GL_COPY_READ_BUFFER, _vertexBuffer);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, scratch);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, from, 0, bytes);
+            glBindBuffer(GL_COPY_READ_BUFFER, scratch);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, _vertexBuffer);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, to, bytes);
+            continue;
+        }
+        glBindBuffer(GL_COPY_READ_BUFFER, _vertexBuffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, _vertexBuffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, from, to, bytes);
+    }
+}
+
+void MeshArena::GrowVertexBuffer(uint32_t vertices) {
+    GLuint grown;
+    glGenBuffers(1, &grown);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, grown);
+    glBufferData(GL_COPY_WRITE_BUFFER, (size_t)vertices * sizeof(Vertex), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_COPY_READ_BUFFER, _vertexBuffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, (size_t)_allocator.Capacity() * sizeof(Vertex));
+    glDeleteBuffers(1, &_vertexBuffer);
+    _vertexBuffer = grown;
+
+    //the VAO captured the old buffer when the attribute was set up
+    glBindVertexArray(_vao);
+    glBindBuffer(GL_ARRAY_BUFFER, _vertexBuffer);
+    glVertexAttribIPointer(0, 1, GL_UNSIGNED_INT, sizeof(Vertex), (void*)0);
+    glBindVertexArray(0);
+    _allocator.Grow(vertices);
+}
+
+void MeshArena::EnsureIndexCapacity(size_t quads) {
+    if (quads <= _indexQuads)
+        return;
+    CreateObjects();
+    size_t capacity = std::max<size_t>(_indexQuads * 2, 4096);
+    while (capacity < quads)
+        capacity *= 2;
+    std::vector<uint32_t> indices(capacity * 6);
+    for (size_t quad = 0; quad < capacity; quad++) {
+        for (int i = 0; i < 6; i++)
+            indices[quad * 6 + i] = (uint32_t)(quad * 4) + QuadIndices[i];
+    }
+    //the element buffer binding is VAO state
+    glBindVertexArray(_vao);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indexBuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint32_t), indices.data(), GL_STATIC_DRAW);
+    glBindVertexArray(0);
+    _indexQuads = capacity;
+}
+
+GLuint MeshArena::ScratchBuffer(size_t vertices) {
+    if (vertices <= _scratchVertices)
+        return _scratchBuffer;
+    size_t capacity = std::max<size_t>(_scratchVertices * 2, 4096);
+    while (capacity < vertices)
+        capacity *= 2;
+    if (_scratchBuffer == 0)
+        glGenBuffers(1, &_scratchBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, _scratchBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, capacity * sizeof(Vertex), nullptr, GL_STREAM_COPY);
+    _scratchVertices = capacity;
+    return _scratchBuffer;
+}
+
+void MeshArena::Draw(const DrawCommandBuilder& draws) {
+    if (draws.Empty())
+        return;
+    CreateObjects();
+    const std::vector<DrawElementsIndirectCommand>& commands = draws.Commands();
+    const std::vector<glm::ivec2>& positions = draws.Positions();
+    //respecified every frame, so the driver hands out fresh storage instead of waiting for the last frame's draw to read the old one
+    _commandBytes = commands.size() * sizeof(DrawElementsIndirectCommand);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _commandBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, _commandBytes, commands.data(), GL_STREAM_DRAW);
+    _positionBytes = positions.size() * sizeof(glm::ivec2);
+    glBindBuffer(GL_ARRAY_BUFFER, _positionBuffer);
+    glBufferData(GL_ARRAY_BUFFER, _positionBytes, positions.data(), GL_STREAM_DRAW);
+
+    glBindVertexArray(_vao);
+    glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, (GLsizei)commands.size(), 0);
+    glBindVertexArray(0);
+}
+
+size_t MeshArena::GpuBytes() const noexcept {
+    return (size_t)_allocator.Capacity() * sizeof(Vertex) + _indexQuads * 6 * sizeof(uint32_t) + _scratchVertices * sizeof(Vertex)
+        + _commandBytes + _positionBytes;
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include "World/ArenaAllocator.h"
+#include "World/DrawCommands.h"
+#include <glad/glad.h>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/// <summary>
+/// One vertex buffer every chunk mesh is sub-allocated from, drawn together with a single glMultiDrawElementsIndirect.
+/// Owns the VAO, the shared quad index buffer, the copy scratch buffer chunks splice their meshes through,
+/// and the per frame indirect command and chunk position buffers.
+/// GL objects are created on first use and must only be touched on the render thread.
+/// </summary>
+class MeshArena {
+public:
+	/// <summary>
+	/// Vertices the arena buffer starts with, it doubles whenever an allocation doesn't fit
+	/// </summary>
+	static constexpr uint32_t InitialVertices = 1 << 20;
+
+	MeshArena() = default;
+	MeshArena(const MeshArena&) = delete;
+	MeshArena& operator=(const MeshArena&) = delete;
+	/// <summary>
+	/// Deletes the GL objects while the context is still alive. The destructor makes no GL calls, so this has to run before the context goes.
+	/// Allocations are left as they were, the arena isn't used again afterwards.
+	/// </summary>
+	void Destroy();
+	/// <summary>
+	/// Handle of a new range of vertices in the arena buffer. Growing the buffer keeps every existing range where it is.
+	/// </summary>
+	uint32_t Allocate(uint32_t vertices);
+	void Free(uint32_t handle);
+	/// <summary>
+	/// Vertex offset of an allocation, which changes when Compact moves it
+	/// </summary>
+	inline uint32_t Offset(uint32_t handle) const noexcept {
+		return _allocator.Offset(handle);
+	}
+	GLuint VertexBuffer() const noexcept {
+		return _vertexBuffer;
+	}
+	/// <summary>
+	/// Grows the shared quad index buffer to cover a mesh of at least quads quads
+	/// </summary>
+	void EnsureIndexCapacity(size_t quads);
+	/// <summary>
+	/// Scratch buffer of at least vertices vertices for parking mesh ranges while they move
+	/// </summary>
+	GLuint ScratchBuffer(size_t vertices);
+	/// <summary>
+	/// Moves up to maxVertices vertices of allocations down into the free ranges below them with copies inside the arena buffer,
+	/// so the free space gathers at the end instead of splitting into holes too small for a remeshed chunk
+	/// </summary>
+	void Compact(uint32_t maxVertices);
+	/// <summary>
+	/// Uploads the frame's commands and chunk positions and draws them with one call
+	/// </summary>
+	void Draw(const DrawCommandBuilder& draws);
+	const ArenaAllocator& Allocator() const noexcept {
+		return _allocator;
+	}
+	/// <summary>
+	/// Bytes allocated on the gpu for the arena, index, scratch and per frame buffers
+	/// </summary>
+	size_t GpuBytes() const noexcept;
+private:
+	ArenaAllocator _allocator;
+	std::vector<ArenaAllocator::Move> _moves;
+	GLuint _vao = 0;
+	GLuint _vertexBuffer = 0;
+	GLuint _indexBuffer = 0;
+	GLuint _scratchBuffer = 0;
+	GLuint _commandBuffer = 0;
+	GLuint _positionBuffer = 0;
+	size_t _indexQuads = 0;
+	size_t _scratchVertices = 0;
+	size_t _commandBytes = 0;
+	size_t _positionBytes = 0;
+
+	void CreateObjects();
+	void GrowVertexBuffer(uint32_t vertices);
+};
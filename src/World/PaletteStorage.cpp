@@ -0,0 +1,97 @@
+#include "World/PaletteStorage.h"
+
+PaletteStorage::PaletteStorage(size_t size, int fillID) : _size(size) {
+    _palette.push_back(fillID);
+}
+
+void PaletteStorage::Set(size_t index, int ID) {
+    if (_bitsPerIndex == 0 && _palette[0] == ID)
+        return;
+    int paletteIndex = FindOrAddPaletteIndex(ID);
+    SetIndex(index, (uint64_t)paletteIndex);
+}
+
+void PaletteStorage::Fill(int ID) {
+    _palette.clear();
+    _palette.push_back(ID);
+    _bitsPerIndex = 0;
+    _mask = 0;
+    _data.clear();
+}
+
+void PaletteStorage::Compact() {
+    if (_bitsPerIndex == 0)
+        return;
+    //scratch buffers are per thread so compacting doesn't allocate once they've grown
+    static thread_local std::vector<int> remap;
+    static thread_local std::vector<int> palette;
+    remap.assign(_palette.size(), -1);
+    palette.clear();
+    for (size_t i = 0; i < _size; i++) {
+        size_t bit = i * _bitsPerIndex;
+        uint64_t paletteIndex = (_data[bit >> 6] >> (bit & 63)) & _mask;
+        if (remap[paletteIndex] == -1) {
+            remap[paletteIndex] = (int)palette.size();
+            palette.push_back(_palette[paletteIndex]);
+        }
+    }
+    if (palette.size() == 1) {
+        Fill(palette[0]);
+        return;
+    }
+    int bits = 1;
+    while ((size_t(1) << bits) < palette.size())
+        bits *= 2;
+    if (bits == _bitsPerIndex && palette.size() == _palette.size())
+        return;
+
+    static thread_local std::vector<uint64_t> oldData;
+    oldData.assign(_data.begin(), _data.end());
+    int oldBits = _bitsPerIndex;
+    uint64_t oldMask = _mask;
+    _palette.assign(palette.begin(), palette.end());
+    _bitsPerIndex = bits;
+    _mask = (uint64_t(1) << bits) - 1;
+    _data.assign((_size * bits + 63) / 64, 0);
+    for (size_t i = 0; i < _size; i++) {
+        size_t bit = i * oldBits;
+        SetIndex(i, (uint64_t)remap[(oldData[bit >> 6] >> (bit & 63)) & oldMask]);
+    }
+}
+
+size_t PaletteStorage::MemoryUsage() const {
+    return _palette.capacity() * sizeof(int) + _data.capacity() * sizeof(uint64_t);
+}
+
+int PaletteStorage::FindOrAddPaletteIndex(int ID) {
+    //palettes stay tiny (a handful of block types per chunk), a linear search beats hashing here
+    for (size_t i = 0; i < _palette.size(); i++) {
+        if (_palette[i] == ID)
+            return (int)i;
+    }
+    _palette.push_back(ID);
+    if (_palette.size() > (size_t(1) << _bitsPerIndex)) {
+        //widen to the next power of two so indices never cross a 64 bit word
+        int bits = _bitsPerIndex == 0 ? 1 : _bitsPerIndex * 2;
+        Resize(bits);
+    }
+    return (int)_palette.size() - 1;
+}
+
+void PaletteStorage::Resize(int bitsPerIndex) {
+    //copied rather than moved out so _data keeps its capacity, a recycled chunk reuses it instead of allocating
+    static thread_local std::vector<uint64_t> oldData;
+    oldData.assign(_data.begin(), _data.end());
+    int oldBits = _bitsPerIndex;
+    uint64_t oldMask = _mask;
+
+    _bitsPerIndex = bitsPerIndex;
+    _mask = (uint64_t(1) << bitsPerIndex) - 1;
+    _data.assign((_size * bitsPerIndex + 63) / 64, 0);
+    if (oldBits == 0)
+        return; //every entry was palette index 0
+    for (size_t i = 0; i < _size; i++) {
+        size_t bit = i * oldBits;
+        SetIndex(i, (oldData[bit >> 6] >> (bit & 63)) & oldMask);
+    }
+}
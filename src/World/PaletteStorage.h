@@ -0,0 +1,52 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/// <summary>
+/// Palette compressed block container.
+/// Stores a small palette of the distinct block IDs in use, and a bit packed array of indices into that palette.
+/// Index width starts at 0 bits (every entry is palette[0]) and widens to the next power of two as new IDs are added,
+/// so an entry never straddles two words.
+/// </summary>
+class PaletteStorage {
+public:
+	PaletteStorage(size_t size = 0, int fillID = 0);
+	inline int Get(size_t index) const noexcept {
+		if (_bitsPerIndex == 0)
+			return _palette[0];
+		size_t bit = index * _bitsPerIndex;
+		return _palette[(_data[bit >> 6] >> (bit & 63)) & _mask];
+	}
+	void Set(size_t index, int ID);
+	/// <summary>
+	/// Resets every entry to a single ID. The index array is emptied but keeps its capacity for reuse.
+	/// </summary>
+	void Fill(int ID);
+	/// <summary>
+	/// Drops palette entries that are no longer referenced and narrows the index width to fit.
+	/// A container holding a single ID collapses back to 0 bits per index.
+	/// </summary>
+	void Compact();
+	size_t Size() const { return _size; }
+	int BitsPerIndex() const { return _bitsPerIndex; }
+	const std::vector<int>& Palette() const { return _palette; }
+	/// <summary>
+	/// Approximate heap usage in bytes of the palette and index array.
+	/// </summary>
+	size_t MemoryUsage() const;
+private:
+	size_t _size;
+	int _bitsPerIndex = 0;
+	uint64_t _mask = 0;
+	std::vector<int> _palette;
+	std::vector<uint64_t> _data;
+
+	int FindOrAddPaletteIndex(int ID);
+	void Resize(int bitsPerIndex);
+	inline void SetIndex(size_t index, uint64_t paletteIndex) noexcept {
+		size_t bit = index * _bitsPerIndex;
+		uint64_t& word = _data[bit >> 6];
+		word = (word & ~(_mask << (bit & 63))) | (paletteIndex << (bit & 63));
+	}
+};
@@ -0,0 +1,135 @@
+#include "World/StagingRing.h"
+#include <algorithm>
+
+uint8_t* GLStagingBackend::Create(size_t bytes) {
+    //coherent, so worker writes are visible to copies recorded after them without flushing the mapped range
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glGenBuffers(1, &_buffer);
+    glBindBuffer(GL_COPY_READ_BUFFER, _buffer);
+    glBufferStorage(GL_COPY_READ_BUFFER, bytes, nullptr, flags);
+    uint8_t* memory = (uint8_t*)glMapBufferRange(GL_COPY_READ_BUFFER, 0, bytes, flags);
+    //no mapping, no ring, the buffer would only leak
+    if (!memory) {
+        glDeleteBuffers(1, &_buffer);
+        _buffer = 0;
+    }
+    return memory;
+}
+
+StagingBackend::Fence GLStagingBackend::InsertFence() {
+    return (Fence)(uintptr_t)glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+bool GLStagingBackend::IsSignaled(Fence fence) {
+    GLenum status = glClientWaitSync((GLsync)(uintptr_t)fence, 0, 0);
+    return status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED;
+}
+
+void GLStagingBackend::DeleteFence(Fence fence) {
+    glDeleteSync((GLsync)(uintptr_t)fence);
+}
+
+void GLStagingBackend::Destroy() {
+    if (_buffer == 0)
+        return;
+    glBindBuffer(GL_COPY_READ_BUFFER, _buffer);
+    glUnmapBuffer(GL_COPY_READ_BUFFER);
+    glDeleteBuffers(1, &_buffer);
+    _buffer = 0;
+}
+
+StagingRing::StagingRing(std::unique_ptr<StagingBackend> backend) : _backend(std::move(backend)) {
+}
+
+void StagingRing::Destroy() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (const FrameFence& pending : _fences)
+        _backend->DeleteFence(pending.fence);
+    _fences.clear();
+    _regions.clear();
+    _backend->Destroy();
+    _memory = nullptr;
+    _capacity = 0;
+    _head = _tail = 0;
+    _releasedThisFrame = false;
+}
+
+void StagingRing::Create(size_t capacity) {
+    if (_memory)
+        return;
+    capacity = (capacity + Alignment - 1) / Alignment * Alignment;
+    uint8_t* memory = _backend->Create(capacity);
+    std::lock_guard<std::mutex> lock(_mutex);
+    _memory = memory;
+    _capacity = memory ? capacity : 0;
+}
+
+StagingRing::Allocation StagingRing::Allocate(size_t bytes) {
+    size_t size = (bytes + Alignment - 1) / Alignment * Alignment;
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!_memory || size == 0 || size > _capacity) {
+        _failed++;
+        return Allocation();
+    }
+    //an allocation never wraps, the space left at the end is skipped and retired along with it
+    size_t offset = (size_t)(_head % _capacity);
+    size_t padding = offset + size > _capacity ? _capacity - offset : 0;
+    if (_head - _tail + padding + size > _capacity) {
+        _failed++;
+        return Allocation();
+    }
+    Allocation allocation;
+    allocation.offset = padding ? 0 : offset;
+    allocation.data = _memory + allocation.offset;
+    allocation.bytes = bytes;
+    allocation.position = _head;
+    _regions.push_back({ _head, _head + padding + size, 0 });
+    _head += padding + size;
+    return allocation;
+}
+
+void StagingRing::Release(const Allocation& allocation) {
+    if (!allocation)
+        return;
+    std::lock_guard<std::mutex> lock(_mutex);
+    //allocations can be released out of order, the region is only retired once every one before it is
+    auto region = std::lower_bound(_regions.begin(), _regions.end(), allocation.position, [](const Region& region, uint64_t position) {
+        return region.start < position;
+    });
+    region->frame = _frame;
+    _releasedThisFrame = true;
+}
+
+void StagingRing::Submit() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!_releasedThisFrame)
+        return;
+    _fences.push_back({ _backend->InsertFence(), _frame });
+    _frame++;
+    _releasedThisFrame = false;
+}
+
+void StagingRing::Retire() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    //fences pass in the order they were inserted
+    while (!_fences.empty() && _backend->IsSignaled(_fences.front().fence)) {
+        _backend->DeleteFence(_fences.front().fence);
+        _retiredFrame = _fences.front().frame;
+        _fences.pop_front();
+    }
+    while (!_regions.empty() && _regions.front().frame != 0 && _regions.front().frame <= _retiredFrame) {
+        _tail = _regions.front().end;
+        _regions.pop_front();
+    }
+}
+
+StagingRing::Stats StagingRing::GetStats() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    Stats stats;
+    stats.capacity = _capacity;
+    stats.used = (size_t)(_head - _tail);
+    stats.allocations = _regions.size();
+    stats.pendingFences = _fences.size();
+    stats.failed = _failed;
+    return stats;
+}
@@ -0,0 +1,235 @@
+#pragma once
+#include <glad/glad.h>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+#include <cstddef>
+
+/// <summary>
+/// The gpu side of a StagingRing: one buffer mapped for writing for its whole life, and fences that mark when the gpu
+/// has finished the commands recorded before them. Render thread only.
+/// </summary>
+class StagingBackend {
+public:
+	using Fence = uint64_t;
+
+	virtual ~StagingBackend() = default;
+	/// <summary>
+	/// Creates a buffer of bytes bytes and returns its mapping, which stays valid until the backend is destroyed. Null on failure.
+	/// </summary>
+	virtual uint8_t* Create(size_t bytes) = 0;
+	/// <summary>
+	/// Name of the buffer for copies out of it, 0 if there is no gl buffer behind the mapping
+	/// </summary>
+	virtual GLuint Buffer() const noexcept = 0;
+	/// <summary>
+	/// Fence after every command recorded so far
+	/// </summary>
+	virtual Fence InsertFence() = 0;
+	/// <summary>
+	/// True once the gpu has passed fence, doesn't wait
+	/// </summary>
+	virtual bool IsSignaled(Fence fence) = 0;
+	virtual void DeleteFence(Fence fence) = 0;
+	/// <summary>
+	/// Unmaps and deletes the buffer, the destructor leaves it alone so it can outlive the context
+	/// </summary>
+	virtual void Destroy() = 0;
+};
+
+/// <summary>
+/// Persistently mapped, coherent buffer (GL 4.4 buffer storage) with fence syncs
+/// </summary>
+class GLStagingBackend : public StagingBackend {
+public:
+	GLStagingBackend() = default;
+	GLStagingBackend(const GLStagingBackend&) = delete;
+	GLStagingBackend& operator=(const GLStagingBackend&) = delete;
+	uint8_t* Create(size_t bytes) override;
+	GLuint Buffer() const noexcept override {
+		return _buffer;
+	}
+	Fence InsertFence() override;
+	bool IsSignaled(Fence fence) override;
+	void DeleteFence(Fence fence) override;
+	void Destroy() override;
+private:
+	GLuint _buffer = 0;
+};
+
+/// <summary>
+/// Backend without a gpu. The mapping is plain memory and fences pass when told to, so the ring can be driven without a gl context.
+/// </summary>
+class NullStagingBackend : public StagingBackend {
+public:
+	/// <summary>
+	/// Fences pass as soon as they are inserted, otherwise only once Signal reaches them
+	/// </summary>
+	bool signalImmediately = true;
+
+	uint8_t* Create(size_t bytes) override {
+		_memory.assign(bytes, 0);
+		return _memory.data();
+	}
+	GLuint Buffer() const noexcept override {
+		return 0;
+	}
+	Fence InsertFence() override {
+		return ++_inserted;
+	}
+	bool IsSignaled(Fence fence) override {
+		return signalImmediately || fence <= _signaled;
+	}
+	void DeleteFence(Fence) override {}
+	void Destroy() override {
+		_memory.clear();
+	}
+	/// <summary>
+	/// Passes every fence inserted so far
+	/// </summary>
+	void Signal() noexcept {
+		_signaled = _inserted;
+	}
+	Fence LastFence() const noexcept {
+		return _inserted;
+	}
+private:
+	std::vector<uint8_t> _memory;
+	Fence _inserted = 0;
+	Fence _signaled = 0;
+};
+
+/// <summary>
+/// Ring of mapped staging memory that meshing workers write finished meshes into, so the render thread only records copies
+/// out of it instead of uploading from the cpu. Space is handed out in allocation order and comes back in the same order,
+/// once the allocation is released and the fence of the frame that released it has passed, so the gpu never reads
+/// memory that is being written again. An allocation that doesn't fit fails instead of waiting.
+/// Allocate and Release are thread safe, the rest is render thread only.
+/// </summary>
+class StagingRing {
+public:
+	/// <summary>
+	/// Allocations start on a cache line, so two workers never write the same one
+	/// </summary>
+	static constexpr size_t Alignment = 64;
+
+	struct Allocation {
+		/// <summary>
+		/// Mapped memory to write, null if the allocation failed
+		/// </summary>
+		uint8_t* data = nullptr;
+		/// <summary>
+		/// Offset of data in the backend's buffer
+		/// </summary>
+		size_t offset = 0;
+		size_t bytes = 0;
+		/// <summary>
+		/// Where the allocation starts in the ring's running byte count, identifies it to Release
+		/// </summary>
+		uint64_t position = 0;
+		explicit operator bool() const noexcept {
+			return data != nullptr;
+		}
+	};
+	struct Stats {
+		size_t capacity = 0;
+		/// <summary>
+		/// Bytes allocated and not yet retired, including the padding skipped when an allocation wraps
+		/// </summary>
+		size_t used = 0;
+		/// <summary>
+		/// Allocations not yet retired
+		/// </summary>
+		size_t allocations = 0;
+		/// <summary>
+		/// Fences inserted by Submit that haven't passed
+		/// </summary>
+		size_t pendingFences = 0;
+		/// <summary>
+		/// Allocations that failed because the ring was full or not created yet
+		/// </summary>
+		uint64_t failed = 0;
+	};
+
+	explicit StagingRing(std::unique_ptr<StagingBackend> backend);
+	StagingRing(const StagingRing&) = delete;
+	StagingRing& operator=(const StagingRing&) = delete;
+	/// <summary>
+	/// Creates the backend's buffer, rounded up to a multiple of Alignment. Does nothing if it already exists.
+	/// Allocate fails until this has run.
+	/// </summary>
+	void Create(size_t capacity);
+	/// <summary>
+	/// Deletes the pending fences and the backend's buffer while the context is still alive, the destructor makes no GL calls.
+	/// Outstanding allocations are dropped, so the workers writing into the ring have to be stopped first.
+	/// </summary>
+	void Destroy();
+	bool IsCreated() const noexcept {
+		return _memory != nullptr;
+	}
+	/// <summary>
+	/// Space for bytes bytes, or an empty allocation if the ring doesn't have that much free in one piece
+	/// </summary>
+	Allocation Allocate(size_t bytes);
+	/// <summary>
+	/// The allocation's contents won't be read by anything recorded after the next Submit, its space is reused once that fence passes
+	/// </summary>
+	void Release(const Allocation& allocation);
+	/// <summary>
+	/// Fences the commands recorded since the last Submit, call it after the frame's copies out of the ring
+	/// </summary>
+	void Submit();
+	/// <summary>
+	/// Takes back the space of released allocations whose fence has passed, without waiting on the gpu
+	/// </summary>
+	void Retire();
+	GLuint Buffer() const noexcept {
+		return _backend->Buffer();
+	}
+	size_t Capacity() const noexcept {
+		return _capacity;
+	}
+	Stats GetStats() const;
+private:
+	/// <summary>
+	/// An allocation in the ring, from start to end of the running byte count
+	/// </summary>
+	struct Region {
+		uint64_t start;
+		uint64_t end;
+		/// <summary>
+		/// Frame the region was released in, 0 while it's still in use
+		/// </summary>
+		uint64_t frame;
+	};
+	struct FrameFence {
+		StagingBackend::Fence fence;
+		uint64_t frame;
+	};
+	std::unique_ptr<StagingBackend> _backend;
+	uint8_t* _memory = nullptr;
+	size_t _capacity = 0;
+	/// <summary>
+	/// Running byte counts of the next allocation and the oldest unretired one, the ring offset is the count modulo the capacity
+	/// </summary>
+	uint64_t _head = 0;
+	uint64_t _tail = 0;
+	/// <summary>
+	/// Regions in allocation order
+	/// </summary>
+	std::deque<Region> _regions;
+	std::deque<FrameFence> _fences;
+	/// <summary>
+	/// Serial of the frame being recorded, releases are fenced with it by the next Submit
+	/// </summary>
+	uint64_t _frame = 1;
+	/// <summary>
+	/// Newest frame whose fence has passed
+	/// </summary>
+	uint64_t _retiredFrame = 0;
+	bool _releasedThisFrame = false;
+	uint64_t _failed = 0;
+	mutable std::mutex _mutex;
+};
@@ -0,0 +1,30 @@
+#pragma once
+#include <cstdint>
+
+/// <summary>
+/// Chunk mesh vertex packed into 32 bits.
+/// bits 0-4 x (0-16), 5-9 y (0-16), 10-18 z (0-256), 19-21 face, 22-23 corner, 24-31 block ID.
+/// Each quad is 4 vertices drawn through the shared quad index buffer, corner is the vertex's index within the quad.
+/// Decoded the same way in block.vert.
+/// </summary>
+struct Vertex {
+	uint32_t data;
+
+	Vertex(uint32_t x, uint32_t y, uint32_t z, uint32_t face, uint32_t corner, uint32_t block) : data(Pack(x, y, z, face, corner, block)) {}
+
+	static constexpr uint32_t Pack(uint32_t x, uint32_t y, uint32_t z, uint32_t face, uint32_t corner, uint32_t block) {
+		return (x & 31u) | ((y & 31u) << 5) | ((z & 511u) << 10) | ((face & 7u) << 19) | ((corner & 3u) << 22) | ((block & 255u) << 24);
+	}
+	inline uint32_t X() const { return data & 31u; }
+	inline uint32_t Y() const { return (data >> 5) & 31u; }
+	inline uint32_t Z() const { return (data >> 10) & 511u; }
+	inline uint32_t Face() const { return (data >> 19) & 7u; }
+	inline uint32_t Corner() const { return (data >> 22) & 3u; }
+	inline uint32_t Block() const { return data >> 24; }
+};
+static_assert(sizeof(Vertex) == 4, "Vertex must stay 4 bytes");
+
+/// <summary>
+/// Index pattern of one quad, two triangles sharing the v1-v2 edge
+/// </summary>
+constexpr uint32_t QuadIndices[6] = { 0, 1, 2, 2, 1, 3 };
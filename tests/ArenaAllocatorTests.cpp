@@ -0,0 +1,205 @@
+#include "Test.h"
+#include "World/ArenaAllocator.h"
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <random>
+
+namespace {
+    //The arena as the allocator's owner sees it: the live handles, and memory where each allocation is filled with its own tag,
+    //so replaying Compact's moves can be checked to carry every allocation's contents along
+    struct Model {
+        struct Allocation {
+            uint32_t offset;
+            uint32_t size;
+            uint32_t tag;
+        };
+        std::map<uint32_t, Allocation> live;
+        std::vector<uint32_t> memory;
+        uint32_t nextTag = 1;
+
+        void Fill(const Allocation& allocation) {
+            std::fill_n(memory.begin() + allocation.offset, allocation.size, allocation.tag);
+        }
+    };
+
+    //Checks the allocator's bookkeeping against the allocations it handed out. Returns the largest gap between them.
+    uint32_t CheckConsistent(const ArenaAllocator& allocator, const Model& model) {
+        std::vector<Model::Allocation> sorted;
+        uint32_t used = 0;
+        for (const auto& [handle, allocation] : model.live) {
+            CHECK_EQUAL(allocator.Offset(handle), allocation.offset);
+            CHECK_EQUAL(allocator.Size(handle), allocation.size);
+            sorted.push_back(allocation);
+            used += allocation.size;
+        }
+        std::sort(sorted.begin(), sorted.end(), [](const Model::Allocation& a, const Model::Allocation& b) {
+            return a.offset < b.offset;
+        });
+        uint32_t largestGap = 0, gaps = 0, end = 0;
+        for (const Model::Allocation& allocation : sorted) {
+            //no two allocations share a unit
+            CHECK(allocation.offset >= end);
+            if (allocation.offset > end) {
+                gaps++;
+                largestGap = std::max(largestGap, allocation.offset - end);
+            }
+            end = allocation.offset + allocation.size;
+        }
+        CHECK(end <= allocator.Capacity());
+        if (allocator.Capacity() > end) {
+            gaps++;
+            largestGap = std::max(largestGap, allocator.Capacity() - end);
+        }
+        CHECK_EQUAL(allocator.Used(), used);
+        CHECK_EQUAL(allocator.LargestFree(), largestGap);
+
+        ArenaAllocator::Stats stats = allocator.GetStats();
+        CHECK_EQUAL(stats.capacity, allocator.Capacity());
+        CHECK_EQUAL(stats.used, used);
+        CHECK_EQUAL(stats.allocations, (uint32_t)model.live.size());
+        CHECK_EQUAL(stats.top, end);
+        CHECK_EQUAL(stats.largestFree, largestGap);
+        //free neighbors are always merged, so each gap is exactly one free range
+        CHECK_EQUAL(stats.freeRanges, gaps);
+        uint32_t freeSize = allocator.Capacity() - used;
+        float fragmentation = freeSize == 0 ? 0.0f : 1.0f - (float)largestGap / (float)freeSize;
+        CHECK_EQUAL(allocator.Fragmentation(), fragmentation);
+        CHECK_EQUAL(stats.Fragmentation(), fragmentation);
+        return largestGap;
+    }
+
+    //Compacts, replays the moves on the model's memory and checks every allocation still holds its own tag
+    void CompactAndReplay(ArenaAllocator& allocator, Model& model, uint32_t maxSize) {
+        std::vector<ArenaAllocator::Move> moves;
+        uint32_t moved = allocator.Compact(maxSize, moves);
+        uint32_t total = 0;
+        for (const ArenaAllocator::Move& move : moves) {
+            auto found = model.live.find(move.handle);
+            CHECK(found != model.live.end());
+            if (found == model.live.end())
+                continue;
+            Model::Allocation& allocation = found->second;
+            CHECK_EQUAL(move.from, allocation.offset);
+            CHECK_EQUAL(move.size, allocation.size);
+            CHECK(move.to < move.from);
+            //moves can overlap their own source, like a memmove
+            std::memmove(&model.memory[move.to], &model.memory[move.from], move.size * sizeof(uint32_t));
+            allocation.offset = move.to;
+            total += move.size;
+        }
+        CHECK_EQUAL(moved, total);
+        for (const auto& [handle, allocation] : model.live) {
+            bool intact = std::all_of(model.memory.begin() + allocation.offset, model.memory.begin() + allocation.offset + allocation.size,
+                [&](uint32_t tag) { return tag == allocation.tag; });
+            CHECK(intact);
+        }
+        CheckConsistent(allocator, model);
+        //stopping short of the budget means it ran out of holes, everything is packed at the bottom
+        if (moved < maxSize) {
+            ArenaAllocator::Stats stats = allocator.GetStats();
+            CHECK_EQUAL(stats.top, stats.used);
+            CHECK(stats.freeRanges <= 1);
+        }
+    }
+
+    //Random allocations, frees, compactions and growth, checked against the model after every step
+    void RunTrace(uint32_t seed, uint32_t capacity, uint32_t maxAllocation, int steps) {
+        std::mt19937 random(seed);
+        ArenaAllocator allocator(capacity);
+        Model model;
+        model.memory.assign(capacity, 0);
+        for (int step = 0; step < steps; step++) {
+            uint32_t action = random() % 100;
+            if (action < 55) {
+                //mostly small meshes with the occasional large one, like chunks
+                uint32_t size = random() % 4 == 0 ? 1 + random() % maxAllocation : 1 + random() % (maxAllocation / 8 + 1);
+                uint32_t largest = allocator.LargestFree();
+                uint32_t handle = allocator.Allocate(size);
+                //the bins are searched exhaustively, so an allocation only fails if no free range is large enough
+                CHECK_EQUAL(handle == ArenaAllocator::InvalidHandle, size > largest);
+                if (handle != ArenaAllocator::InvalidHandle) {
+                    CHECK(model.live.find(handle) == model.live.end());
+                    Model::Allocation allocation{ allocator.Offset(handle), size, model.nextTag++ };
+                    model.live[handle] = allocation;
+                    model.Fill(allocation);
+                }
+            }
+            else if (action < 92) {
+                if (model.live.empty())
+                    continue;
+                auto victim = model.live.begin();
+                std::advance(victim, random() % model.live.size());
+                allocator.Free(victim->first);
+                model.live.erase(victim);
+            }
+            else if (action < 98) {
+                CompactAndReplay(allocator, model, random() % 3 == 0 ? UINT32_MAX : 1 + random() % maxAllocation);
+                continue;
+            }
+            else if (allocator.Capacity() < capacity * 4) {
+                uint32_t grown = allocator.Capacity() + 1 + random() % capacity;
+                allocator.Grow(grown);
+                model.memory.resize(grown, 0);
+            }
+            CheckConsistent(allocator, model);
+        }
+        //a full compaction packs everything to the bottom, the free space is one range at the end
+        CompactAndReplay(allocator, model, UINT32_MAX);
+        CHECK(allocator.Fragmentation() == 0.0f);
+        while (!model.live.empty()) {
+            allocator.Free(model.live.begin()->first);
+            model.live.erase(model.live.begin());
+        }
+        CHECK_EQUAL(CheckConsistent(allocator, model), allocator.Capacity());
+    }
+}
+
+TEST_CASE(ArenaAllocatorRandomTrace) {
+    //a tight arena that fills up and fails often, one with room to spare, and one with sizes spanning many size classes
+    RunTrace(1, 4096, 256, 20000);
+    RunTrace(2, 1 << 18, 2048, 8000);
+    RunTrace(3, 1 << 16, 30000, 20000);
+}
+
+TEST_CASE(ArenaAllocatorExactFit) {
+    ArenaAllocator allocator(100);
+    uint32_t a = allocator.Allocate(30);
+    uint32_t b = allocator.Allocate(40);
+    uint32_t c = allocator.Allocate(30);
+    CHECK(c != ArenaAllocator::InvalidHandle);
+    CHECK_EQUAL(allocator.Allocate(1), ArenaAllocator::InvalidHandle);
+    CHECK_EQUAL(allocator.LargestFree(), 0u);
+    CHECK(allocator.Fragmentation() == 0.0f);
+    //two holes of 30, neither large enough for 31
+    allocator.Free(a);
+    allocator.Free(c);
+    CHECK_EQUAL(allocator.LargestFree(), 30u);
+    CHECK_EQUAL(allocator.GetStats().freeRanges, 2u);
+    CHECK(allocator.Fragmentation() == 0.5f);
+    CHECK_EQUAL(allocator.Allocate(31), ArenaAllocator::InvalidHandle);
+    //freeing the middle merges all three into one range
+    allocator.Free(b);
+    CHECK_EQUAL(allocator.LargestFree(), 100u);
+    CHECK_EQUAL(allocator.GetStats().freeRanges, 1u);
+    CHECK(allocator.Allocate(100) != ArenaAllocator::InvalidHandle);
+}
+
+TEST_CASE(ArenaAllocatorCompactSlidesOverlappingRanges) {
+    ArenaAllocator allocator(100);
+    uint32_t a = allocator.Allocate(10);
+    uint32_t b = allocator.Allocate(50);
+    allocator.Free(a);
+    //the only allocation is larger than the hole before it, so it slides down onto part of itself
+    std::vector<ArenaAllocator::Move> moves;
+    CHECK_EQUAL(allocator.Compact(UINT32_MAX, moves), 50u);
+    CHECK_EQUAL(moves.size(), (size_t)1);
+    if (moves.size() == 1) {
+        CHECK_EQUAL(moves[0].handle, b);
+        CHECK_EQUAL(moves[0].from, 10u);
+        CHECK_EQUAL(moves[0].to, 0u);
+        CHECK_EQUAL(moves[0].size, 50u);
+    }
+    CHECK_EQUAL(allocator.Offset(b), 0u);
+    CHECK_EQUAL(allocator.LargestFree(), 50u);
+}
@@ -0,0 +1,128 @@
+#include "Test.h"
+#include "World/ChunkMap.h"
+#include <random>
+#include <unordered_map>
+#include <iterator>
+
+namespace {
+    //stand in chunk pointers, ChunkMap never dereferences them
+    Chunk* FakeChunk(size_t i) {
+        return reinterpret_cast<Chunk*>((i + 1) * 64);
+    }
+
+    //ChunkMap's hash, copied so the tests can pick keys by the slot they land in
+    size_t Hash(const glm::ivec2& position) {
+        uint64_t key = (uint64_t)(uint32_t)position.x << 32 | (uint32_t)position.y;
+        key ^= key >> 30;
+        key *= 0xbf58476d1ce4e5b9ull;
+        key ^= key >> 27;
+        key *= 0x94d049bb133111ebull;
+        key ^= key >> 31;
+        return (size_t)key;
+    }
+
+    //the next count keys after start, in scan order, whose home slot in a table of size slots is home
+    std::vector<glm::ivec2> KeysWithHome(size_t home, size_t size, int count, int& start) {
+        std::vector<glm::ivec2> keys;
+        for (; (int)keys.size() < count; start++) {
+            glm::ivec2 key(start % 97 - 48, start / 97 - 48);
+            if ((Hash(key) & (size - 1)) == home)
+                keys.push_back(key);
+        }
+        return keys;
+    }
+
+    struct IVec2Hash {
+        size_t operator()(const glm::ivec2& v) const noexcept {
+            return Hash(v);
+        }
+    };
+}
+
+TEST_CASE(ChunkMapMatchesUnorderedMap) {
+    std::mt19937 random(9);
+    ChunkMap map(4);
+    std::unordered_map<glm::ivec2, Chunk*, IVec2Hash> model;
+    //a small coordinate range so inserts, replacements and erases keep hitting the same keys and the map grows several times
+    std::uniform_int_distribution<int> coordinate(-20, 20);
+    for (int step = 0; step < 200000; step++) {
+        glm::ivec2 key(coordinate(random), coordinate(random));
+        switch (random() % 3) {
+        case 0: {
+            Chunk* chunk = FakeChunk(step);
+            map.Insert(key, chunk);
+            model[key] = chunk;
+            break;
+        }
+        case 1:
+            CHECK_EQUAL(map.Erase(key), model.erase(key) == 1);
+            break;
+        default: {
+            auto found = model.find(key);
+            CHECK(map.Find(key) == (found == model.end() ? nullptr : found->second));
+            break;
+        }
+        }
+        CHECK_EQUAL(map.Size(), model.size());
+    }
+    size_t visited = 0;
+    map.ForEach([&](const glm::ivec2& position, Chunk* chunk) {
+        visited++;
+        auto found = model.find(position);
+        CHECK(found != model.end() && found->second == chunk);
+    });
+    CHECK_EQUAL(visited, model.size());
+}
+
+TEST_CASE(ChunkMapEraseWrapsAround) {
+    //16 slots, few enough keys that it never grows
+    const size_t size = 16;
+    int start = 0;
+    //a run that starts in the last slot and wraps onto slots 0 and 1, followed by a key that belongs in slot 0
+    std::vector<glm::ivec2> last = KeysWithHome(size - 1, size, 3, start);
+    std::vector<glm::ivec2> first = KeysWithHome(0, size, 1, start);
+    std::vector<glm::ivec2> keys = { last[0], last[1], last[2], first[0] };
+    for (int erased = 0; erased < 4; erased++) {
+        ChunkMap map(8);
+        for (size_t i = 0; i < keys.size(); i++)
+            map.Insert(keys[i], FakeChunk(i));
+        //erasing any one of them shifts the ones after it back across the end of the table
+        CHECK(map.Erase(keys[erased]));
+        CHECK(!map.Erase(keys[erased]));
+        CHECK(map.Find(keys[erased]) == nullptr);
+        for (size_t i = 0; i < keys.size(); i++) {
+            if ((int)i != erased)
+                CHECK(map.Find(keys[i]) == FakeChunk(i));
+        }
+        CHECK_EQUAL(map.Size(), keys.size() - 1);
+        //the freed slot is reused and nothing that was found before is lost
+        map.Insert(keys[erased], FakeChunk(100));
+        for (size_t i = 0; i < keys.size(); i++)
+            CHECK(map.Find(keys[i]) == ((int)i == erased ? FakeChunk(100) : FakeChunk(i)));
+    }
+    //draining the run in insertion order and in reverse both leave an empty table
+    for (int reverse = 0; reverse < 2; reverse++) {
+        ChunkMap map(8);
+        for (size_t i = 0; i < keys.size(); i++)
+            map.Insert(keys[i], FakeChunk(i));
+        for (size_t n = 0; n < keys.size(); n++) {
+            size_t i = reverse ? keys.size() - 1 - n : n;
+            CHECK(map.Erase(keys[i]));
+            for (size_t j = 0; j < keys.size(); j++) {
+                bool gone = reverse ? j >= i : j <= i;
+                CHECK(map.Find(keys[j]) == (gone ? nullptr : FakeChunk(j)));
+            }
+        }
+        CHECK(map.Empty());
+    }
+}
+
+TEST_CASE(ChunkMapKeepsNegativeAndDistantCoordinates) {
+    ChunkMap map;
+    const glm::ivec2 keys[] = { { 0, 0 }, { -1, 0 }, { 0, -1 }, { -1, -1 }, { 1, -1 }, { INT32_MAX, INT32_MIN }, { INT32_MIN, INT32_MAX }, { 123456, -654321 } };
+    for (size_t i = 0; i < std::size(keys); i++)
+        map.Insert(keys[i], FakeChunk(i));
+    for (size_t i = 0; i < std::size(keys); i++)
+        CHECK(map.Find(keys[i]) == FakeChunk(i));
+    CHECK(map.Find(glm::ivec2(1, 1)) == nullptr);
+}
@@ -0,0 +1,140 @@
+#include "MeshFaces.h"
+#include <memory>
+
+//The naive mesher emits one quad per bit of the column face masks, so its faces are exactly what the bitmask culling found visible
+
+namespace {
+    //five chunks, the one under test and its north, east, south and west neighbors
+    struct Neighborhood {
+        std::unique_ptr<Chunk[]> chunks{ new Chunk[5] };
+
+        Neighborhood() {
+            for (int i = 0; i < 5; i++)
+                MeshFaces::Clear(chunks[i]);
+        }
+        Chunk& Center() {
+            return chunks[0];
+        }
+        Chunk& Side(ChunkSide side) {
+            return chunks[1 + (int)side];
+        }
+        //neighbors present where bit n of present is set, solid stand ins elsewhere
+        MeshFaces::Neighbors Get(int present = 0xF) const {
+            MeshFaces::Neighbors neighbors;
+            for (int side = 0; side < 4; side++)
+                neighbors.sides[side] = (present >> side) & 1 ? &chunks[1 + side] : nullptr;
+            return neighbors;
+        }
+    };
+
+    void CheckMatchesReference(Chunk& chunk, const MeshFaces::Neighbors& neighbors) {
+        MeshFaces::FaceList reference = MeshFaces::Reference(chunk, neighbors);
+        MeshFaces::FaceList naive = MeshFaces::Mesh(chunk, neighbors, MeshingMode::Naive);
+        CHECK_EQUAL(naive.size(), reference.size());
+        CHECK(naive == reference);
+    }
+}
+
+TEST_CASE(FaceCullingEmptyChunk) {
+    Neighborhood world;
+    CHECK(MeshFaces::Mesh(world.Center(), world.Get(0), MeshingMode::Naive).empty());
+    CHECK(MeshFaces::Mesh(world.Center(), world.Get(), MeshingMode::Naive).empty());
+}
+
+TEST_CASE(FaceCullingSolidChunk) {
+    Neighborhood world;
+    Chunk& chunk = world.Center();
+    for (int x = 0; x < 16; x++)
+        for (int y = 0; y < 16; y++)
+            for (int z = 0; z < 256; z++)
+                chunk.SetBlock(x, y, z, 1);
+    //only the top and bottom of the world show when every side is hidden
+    CHECK_EQUAL(MeshFaces::Mesh(chunk, world.Get(0), MeshingMode::Naive).size(), (size_t)(2 * 16 * 16));
+    CheckMatchesReference(chunk, world.Get(0));
+    //empty neighbors expose the whole of every side
+    CHECK_EQUAL(MeshFaces::Mesh(chunk, world.Get(), MeshingMode::Naive).size(), (size_t)(2 * 16 * 16 + 4 * 16 * 256));
+    CheckMatchesReference(chunk, world.Get());
+    for (int present = 0; present < 16; present++)
+        CheckMatchesReference(chunk, world.Get(present));
+}
+
+TEST_CASE(FaceCullingCheckerboard) {
+    Neighborhood world;
+    for (int i = 0; i < 5; i++) {
+        for (int x = 0; x < 16; x++)
+            for (int y = 0; y < 16; y++)
+                for (int z = 0; z < 40; z++)
+                    world.chunks[i].SetBlock(x, y, z, (x + y + z + i) % 2 ? 1 + (x + z) % 3 : 0);
+    }
+    //every block of a checkerboard shows all six faces, except where the border or the bottom hides them
+    CheckMatchesReference(world.Center(), world.Get());
+    CheckMatchesReference(world.Center(), world.Get(0));
+    CheckMatchesReference(world.Center(), world.Get(0x5));
+}
+
+TEST_CASE(FaceCullingWorldTopAndBottom) {
+    Neighborhood world;
+    Chunk& chunk = world.Center();
+    chunk.SetBlock(0, 0, 0, 2);
+    chunk.SetBlock(15, 15, 255, 3);
+    chunk.SetBlock(7, 8, 255, 4);
+    chunk.SetBlock(7, 8, 254, 4);
+    CheckMatchesReference(chunk, world.Get());
+    CheckMatchesReference(chunk, world.Get(0));
+    //nothing above 255 or below 0, so those faces always show
+    MeshFaces::FaceList faces = MeshFaces::Mesh(chunk, world.Get(0), MeshingMode::Naive);
+    CHECK(std::binary_search(faces.begin(), faces.end(), MeshFaces::Face(0, 0, 0, 4, 2)));
+    CHECK(std::binary_search(faces.begin(), faces.end(), MeshFaces::Face(15, 15, 255, 5, 3)));
+    CHECK(!std::binary_search(faces.begin(), faces.end(), MeshFaces::Face(7, 8, 254, 5, 4)));
+}
+
+TEST_CASE(FaceCullingBorders) {
+    Neighborhood world;
+    Chunk& chunk = world.Center();
+    //a wall along every edge of the chunk, and blocks in the neighbors facing some of it
+    for (int i = 0; i < 16; i++) {
+        for (int z = 60; z < 70; z++) {
+            chunk.SetBlock(i, 0, z, 1);
+            chunk.SetBlock(i, 15, z, 1);
+            chunk.SetBlock(0, i, z, 1);
+            chunk.SetBlock(15, i, z, 1);
+        }
+        world.Side(ChunkSide::North).SetBlock(i, 0, 60 + i % 10, 2);
+        world.Side(ChunkSide::East).SetBlock(0, i, 61, 2);
+        world.Side(ChunkSide::South).SetBlock(i, 15, 65, 2);
+        world.Side(ChunkSide::West).SetBlock(15, i, 69, 2);
+    }
+    for (int present = 0; present < 16; present++)
+        CheckMatchesReference(chunk, world.Get(present));
+}
+
+TEST_CASE(FaceCullingRandomChunks) {
+    std::mt19937 random(4);
+    const float densities[] = { 0.05f, 0.3f, 0.5f, 0.7f, 0.95f };
+    for (int trial = 0; trial < 20; trial++) {
+        Neighborhood world;
+        float density = densities[trial % 5];
+        int zMin = (int)(random() % 200);
+        int zMax = std::min(256, zMin + 20 + (int)(random() % 60));
+        if (trial % 4 == 0) {
+            //reach both ends of the column
+            zMin = 0;
+            zMax = 256;
+        }
+        for (int i = 0; i < 5; i++)
+            MeshFaces::FillRandom(world.chunks[i], random, density, zMin, zMax, 4);
+        CheckMatchesReference(world.Center(), world.Get((int)(random() % 16)));
+    }
+}
+
+TEST_CASE(FaceCullingGeneratedTerrain) {
+    Neighborhood world;
+    const glm::vec2 center(37, -12);
+    const glm::vec2 offsets[5] = { { 0, 0 }, { 0, 1 }, { 1, 0 }, { 0, -1 }, { -1, 0 } };
+    for (int i = 0; i < 5; i++) {
+        world.chunks[i].position = center + offsets[i];
+        world.chunks[i].Generate();
+    }
+    CheckMatchesReference(world.Center(), world.Get());
+    CheckMatchesReference(world.Center(), world.Get(0));
+}
@@ -0,0 +1,116 @@
+#include "Test.h"
+#include "World/Frustum.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <cmath>
+#include <iterator>
+#include <random>
+
+namespace {
+    //the engine's projection, looking from eye toward target with z up like the player
+    Frustum MakeFrustum(const glm::vec3& eye, const glm::vec3& target, float fov = 70.0f, float aspect = 1000.0f / 600.0f) {
+        glm::mat4 projection = glm::perspective(glm::radians(fov), aspect, 0.1f, 1000.0f);
+        return Frustum::FromMatrix(projection * glm::lookAt(eye, target, glm::vec3(0.0f, 0.0f, 1.0f)));
+    }
+
+    //a frustum from a random spot looking a random way, never straight up or down so lookAt's up vector stays valid
+    Frustum RandomFrustum(std::mt19937& random) {
+        std::uniform_real_distribution<float> position(-200.0f, 200.0f);
+        std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+        std::uniform_real_distribution<float> pitch(-1.4f, 1.4f);
+        std::uniform_real_distribution<float> fov(30.0f, 110.0f);
+        std::uniform_real_distribution<float> aspect(0.5f, 2.5f);
+        glm::vec3 eye(position(random), position(random), position(random) * 0.5f + 100.0f);
+        float yaw = angle(random), tilt = pitch(random);
+        glm::vec3 look(std::cos(yaw) * std::cos(tilt), std::sin(yaw) * std::cos(tilt), std::sin(tilt));
+        return MakeFrustum(eye, eye + look, fov(random), aspect(random));
+    }
+
+    //chunk columns and smaller boxes scattered around the frustum and out past its far plane, many of them straddling a plane
+    void RandomBoxes(std::mt19937& random, size_t count, BoxBatch& boxes) {
+        std::uniform_real_distribution<float> position(-1400.0f, 1400.0f);
+        std::uniform_real_distribution<float> extent(0.0f, 64.0f);
+        boxes.Clear();
+        for (size_t i = 0; i < count; i++) {
+            glm::vec3 min(position(random), position(random), position(random) * 0.25f);
+            if (random() % 2)
+                boxes.Add(min, min + glm::vec3(16.0f, 16.0f, 256.0f));
+            else
+                boxes.Add(min, min + glm::vec3(extent(random), extent(random), extent(random)));
+        }
+    }
+
+    //CullBoxes has to agree with IntersectsBox on every box, whichever path of CullBoxes handled it
+    int CountMismatches(const Frustum& frustum, const BoxBatch& boxes) {
+        std::vector<uint8_t> visible(3, 7);
+        frustum.CullBoxes(boxes, visible);
+        CHECK_EQUAL(visible.size(), boxes.Size());
+        int mismatches = 0;
+        for (size_t i = 0; i < boxes.Size() && i < visible.size(); i++) {
+            glm::vec3 min(boxes.Min(0)[i], boxes.Min(1)[i], boxes.Min(2)[i]);
+            glm::vec3 max(boxes.Max(0)[i], boxes.Max(1)[i], boxes.Max(2)[i]);
+            CHECK(visible[i] == 0 || visible[i] == 1);
+            mismatches += visible[i] != (uint8_t)frustum.IntersectsBox(min, max);
+        }
+        return mismatches;
+    }
+}
+
+TEST_CASE(FrustumCullBoxesMatchesIntersectsBox) {
+    std::mt19937 random(25);
+    BoxBatch boxes;
+    //every count up to a few groups of four, so each length of scalar tail is covered, then a few larger ones that aren't multiples of 4
+    const size_t larger[] = { 17, 31, 63, 255, 1001, 4099 };
+    int mismatches = 0, visible = 0, total = 0;
+    for (int trial = 0; trial < 200; trial++) {
+        Frustum frustum = RandomFrustum(random);
+        for (size_t count = 0; count <= 13; count++) {
+            RandomBoxes(random, count, boxes);
+            mismatches += CountMismatches(frustum, boxes);
+        }
+        RandomBoxes(random, larger[trial % std::size(larger)], boxes);
+        mismatches += CountMismatches(frustum, boxes);
+        std::vector<uint8_t> result;
+        frustum.CullBoxes(boxes, result);
+        for (uint8_t box : result)
+            visible += box;
+        total += (int)result.size();
+    }
+    CHECK_EQUAL(mismatches, 0);
+    //the boxes aren't all on one side, both answers get exercised
+    CHECK(visible > total / 20);
+    CHECK(visible < total - total / 20);
+}
+
+TEST_CASE(FrustumCullsKnownBoxes) {
+    //looking down +x from the origin
+    Frustum frustum = MakeFrustum(glm::vec3(0.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+    //ahead, behind, past the far plane, around the eye, far off to the left, and a column reaching up into view from below
+    const glm::vec3 known[][2] = {
+        { { 50.0f, -1.0f, -1.0f }, { 52.0f, 1.0f, 1.0f } },
+        { { -52.0f, -1.0f, -1.0f }, { -50.0f, 1.0f, 1.0f } },
+        { { 1100.0f, -1.0f, -1.0f }, { 1102.0f, 1.0f, 1.0f } },
+        { { -8.0f, -8.0f, -8.0f }, { 8.0f, 8.0f, 8.0f } },
+        { { 10.0f, 500.0f, -1.0f }, { 12.0f, 502.0f, 1.0f } },
+        { { 100.0f, -8.0f, -256.0f }, { 116.0f, 8.0f, 0.0f } },
+    };
+    const uint8_t expected[] = { 1, 0, 0, 1, 0, 1 };
+    for (size_t i = 0; i < std::size(known); i++)
+        CHECK_EQUAL((int)frustum.IntersectsBox(known[i][0], known[i][1]), (int)expected[i]);
+    //behind boxes in front of them shift the known ones through every lane of a group of four and into the scalar tail
+    for (size_t shift = 0; shift < 4; shift++) {
+        BoxBatch boxes;
+        for (size_t i = 0; i < shift; i++)
+            boxes.Add(known[1][0], known[1][1]);
+        for (const glm::vec3(&box)[2] : known)
+            boxes.Add(box[0], box[1]);
+        std::vector<uint8_t> visible;
+        frustum.CullBoxes(boxes, visible);
+        CHECK_EQUAL(visible.size(), boxes.Size());
+        if (visible.size() != boxes.Size())
+            continue;
+        for (size_t i = 0; i < shift; i++)
+            CHECK_EQUAL((int)visible[i], 0);
+        for (size_t i = 0; i < std::size(expected); i++)
+            CHECK_EQUAL((int)visible[shift + i], (int)expected[i]);
+    }
+}
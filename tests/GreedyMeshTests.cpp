@@ -0,0 +1,143 @@
+#include "MeshFaces.h"
+#include <memory>
+
+//Greedy quads have to cover exactly the faces the naive mesher emits one by one, no face missing, none covered twice
+
+namespace {
+    struct Neighborhood {
+        std::unique_ptr<Chunk[]> chunks{ new Chunk[5] };
+
+        Neighborhood() {
+            for (int i = 0; i < 5; i++)
+                MeshFaces::Clear(chunks[i]);
+        }
+        Chunk& Center() {
+            return chunks[0];
+        }
+        MeshFaces::Neighbors Get(int present = 0xF) const {
+            MeshFaces::Neighbors neighbors;
+            for (int side = 0; side < 4; side++)
+                neighbors.sides[side] = (present >> side) & 1 ? &chunks[1 + side] : nullptr;
+            return neighbors;
+        }
+    };
+
+    void CheckGreedyMatchesNaive(Chunk& chunk, const MeshFaces::Neighbors& neighbors) {
+        size_t naiveVertices = 0, greedyVertices = 0;
+        MeshFaces::FaceList naive = MeshFaces::Mesh(chunk, neighbors, MeshingMode::Naive, &naiveVertices);
+        MeshFaces::FaceList greedy = MeshFaces::Mesh(chunk, neighbors, MeshingMode::Greedy, &greedyVertices);
+        CHECK(!MeshFaces::HasDuplicates(greedy));
+        CHECK_EQUAL(greedy.size(), naive.size());
+        CHECK(greedy == naive);
+        CHECK(greedy == MeshFaces::Reference(chunk, neighbors));
+        CHECK(greedyVertices <= naiveVertices);
+    }
+}
+
+TEST_CASE(GreedyMeshFlatPlane) {
+    Neighborhood world;
+    Chunk& chunk = world.Center();
+    for (int x = 0; x < 16; x++)
+        for (int y = 0; y < 16; y++)
+            chunk.SetBlock(x, y, 64, 1);
+    CheckGreedyMatchesNaive(chunk, world.Get());
+    //one quad each for the top, the bottom and the four open sides
+    size_t vertices = 0;
+    MeshFaces::Mesh(chunk, world.Get(), MeshingMode::Greedy, &vertices);
+    CHECK_EQUAL(vertices, (size_t)(6 * 4));
+    //hidden sides drop out
+    MeshFaces::Mesh(chunk, world.Get(0), MeshingMode::Greedy, &vertices);
+    CHECK_EQUAL(vertices, (size_t)(2 * 4));
+}
+
+TEST_CASE(GreedyMeshSingleBlocks) {
+    Neighborhood world;
+    Chunk& chunk = world.Center();
+    const int blocks[][3] = { { 0, 0, 0 }, { 15, 15, 255 }, { 0, 15, 17 }, { 15, 0, 31 }, { 8, 8, 32 }, { 3, 12, 128 } };
+    for (const int(&block)[3] : blocks)
+        chunk.SetBlock(block[0], block[1], block[2], 5);
+    CheckGreedyMatchesNaive(chunk, world.Get());
+    CheckGreedyMatchesNaive(chunk, world.Get(0));
+    //a lone block can't merge with anything
+    size_t naive = 0, greedy = 0;
+    MeshFaces::Mesh(chunk, world.Get(), MeshingMode::Naive, &naive);
+    MeshFaces::Mesh(chunk, world.Get(), MeshingMode::Greedy, &greedy);
+    CHECK_EQUAL(greedy, naive);
+}
+
+TEST_CASE(GreedyMeshCheckerboard) {
+    Neighborhood world;
+    Chunk& chunk = world.Center();
+    for (int x = 0; x < 16; x++)
+        for (int y = 0; y < 16; y++)
+            for (int z = 10; z < 30; z++)
+                chunk.SetBlock(x, y, z, (x + y + z) % 2 ? 1 : 0);
+    CheckGreedyMatchesNaive(chunk, world.Get());
+    CheckGreedyMatchesNaive(chunk, world.Get(0));
+}
+
+TEST_CASE(GreedyMeshStripes) {
+    Neighborhood world;
+    Chunk& chunk = world.Center();
+    //solid slabs whose stripes of different IDs must not merge across each other, along each axis in turn
+    for (int x = 0; x < 16; x++) {
+        for (int y = 0; y < 16; y++) {
+            for (int z = 40; z < 48; z++)
+                chunk.SetBlock(x, y, z, 1 + x % 3);
+            for (int z = 48; z < 56; z++)
+                chunk.SetBlock(x, y, z, 1 + y % 2);
+            for (int z = 56; z < 72; z++)
+                chunk.SetBlock(x, y, z, 1 + (z / 3) % 4);
+        }
+    }
+    CheckGreedyMatchesNaive(chunk, world.Get());
+    CheckGreedyMatchesNaive(chunk, world.Get(0x3));
+    //the top of the last slab keeps the ID of its stripe
+    MeshFaces::FaceList faces = MeshFaces::Mesh(chunk, world.Get(), MeshingMode::Greedy);
+    CHECK(std::binary_search(faces.begin(), faces.end(), MeshFaces::Face(0, 0, 71, 5, 1 + (71 / 3) % 4)));
+}
+
+TEST_CASE(GreedyMeshBorders) {
+    Neighborhood world;
+    Chunk& chunk = world.Center();
+    for (int x = 0; x < 16; x++)
+        for (int y = 0; y < 16; y++)
+            for (int z = 0; z < 20 + (x + y) % 5; z++)
+                chunk.SetBlock(x, y, z, 2);
+    //neighbors that cover the border only in patches, so the side quads are split where the neighbor hides them
+    std::mt19937 random(11);
+    for (int i = 1; i < 5; i++)
+        MeshFaces::FillRandom(world.chunks[i], random, 0.5f, 0, 24, 1);
+    for (int present = 0; present < 16; present++)
+        CheckGreedyMatchesNaive(chunk, world.Get(present));
+}
+
+TEST_CASE(GreedyMeshRandomChunks) {
+    std::mt19937 random(5);
+    const float densities[] = { 0.1f, 0.5f, 0.8f, 0.97f };
+    for (int trial = 0; trial < 20; trial++) {
+        Neighborhood world;
+        int zMin = trial % 5 == 0 ? 0 : (int)(random() % 180);
+        int zMax = trial % 5 == 0 ? 256 : zMin + 16 + (int)(random() % 60);
+        //few IDs and high densities leave long runs for the greedy mesher to merge
+        int blockIDs = 1 + trial % 3;
+        for (int i = 0; i < 5; i++)
+            MeshFaces::FillRandom(world.chunks[i], random, densities[trial % 4], zMin, zMax, blockIDs);
+        CheckGreedyMatchesNaive(world.Center(), world.Get((int)(random() % 16)));
+    }
+}
+
+TEST_CASE(GreedyMeshGeneratedTerrain) {
+    Neighborhood world;
+    const glm::vec2 offsets[5] = { { 0, 0 }, { 0, 1 }, { 1, 0 }, { 0, -1 }, { -1, 0 } };
+    for (int i = 0; i < 5; i++) {
+        world.chunks[i].position = glm::vec2(-20, 55) + offsets[i];
+        world.chunks[i].Generate();
+    }
+    std::mt19937 random(6);
+    //dig into the terrain so there are caves and overhangs as well as the surface
+    for (int edit = 0; edit < 2000; edit++)
+        world.Center().SetBlock(random() % 16, random() % 16, 40 + random() % 120, random() % 3 == 0 ? 1 + random() % 3 : 0);
+    CheckGreedyMatchesNaive(world.Center(), world.Get());
+    CheckGreedyMatchesNaive(world.Center(), world.Get(0));
+}
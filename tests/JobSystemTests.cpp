@@ -0,0 +1,58 @@
+#include "Test.h"
+#include "Thread/JobSystem.h"
+#include <chrono>
+#include <memory>
+
+namespace {
+    void WaitFor(const std::atomic<int>& remaining) {
+        while (remaining.load() > 0)
+            std::this_thread::yield();
+    }
+}
+
+TEST_CASE(JobSystemRunsEveryJob) {
+    JobSystem workers(4);
+    std::atomic<int> ran{ 0 };
+    std::atomic<int> remaining{ 1000 + 1000 * 4 };
+    //jobs queued from outside go round robin, jobs queued from a worker go to its own deque and get stolen from there
+    for (int i = 0; i < 1000; i++) {
+        workers.enqueue([&workers, &ran, &remaining] {
+            for (int j = 0; j < 4; j++) {
+                workers.enqueue([&ran, &remaining] {
+                    ran.fetch_add(1);
+                    remaining.fetch_sub(1);
+                });
+            }
+            ran.fetch_add(1);
+            remaining.fetch_sub(1);
+        });
+    }
+    WaitFor(remaining);
+    CHECK_EQUAL(ran.load(), 5000);
+}
+
+TEST_CASE(JobSystemJoinDiscardsQueuedJobs) {
+    JobSystem workers(1);
+    std::atomic<bool> started{ false }, release{ false };
+    std::atomic<int> ran{ 0 };
+    std::shared_ptr<int> token = std::make_shared<int>(0);
+    //the only worker is held in the first job while the rest queue up behind it
+    workers.enqueue([&started, &release] {
+        started = true;
+        while (!release.load())
+            std::this_thread::yield();
+    });
+    while (!started.load())
+        std::this_thread::yield();
+    for (int i = 0; i < 100; i++)
+        workers.enqueue([&ran, token] { ran.fetch_add(1); });
+    CHECK_EQUAL(token.use_count(), 101L);
+    //join has to be waiting on the worker before the first job lets go, the sleep gives it time to get there
+    std::thread joiner([&workers] { workers.join(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    release = true;
+    joiner.join();
+    CHECK_EQUAL(ran.load(), 0);
+    //the queued jobs were destroyed by join, not left for the destructor
+    CHECK_EQUAL(token.use_count(), 1L);
+}
@@ -0,0 +1,158 @@
+#pragma once
+#include "Test.h"
+#include "World/Chunk.h"
+#include <algorithm>
+#include <random>
+#include <tuple>
+#include <vector>
+
+/// <summary>
+/// Helpers shared by the meshing tests: chunks built block by block, and meshes flattened into the unit faces they cover
+/// so the naive mesher, the greedy mesher and a per voxel reference can be compared face for face.
+/// </summary>
+namespace MeshFaces {
+	/// <summary>
+	/// x, y, z of the block the face belongs to, face index, block ID
+	/// </summary>
+	using Face = std::tuple<int, int, int, int, int>;
+	/// <summary>
+	/// Sorted, duplicates kept so overlapping quads show up as a mismatch
+	/// </summary>
+	using FaceList = std::vector<Face>;
+
+	/// <summary>
+	/// Neighbors in ChunkSide order, north, east, south, west. Null stands in solid, like a neighbor that isn't generated.
+	/// </summary>
+	struct Neighbors {
+		const Chunk* sides[4] = { nullptr, nullptr, nullptr, nullptr };
+	};
+
+	/// <summary>
+	/// Empties a chunk the way Generate does before filling it, so SetBlock can build it by hand
+	/// </summary>
+	inline void Clear(Chunk& chunk) {
+		for (std::shared_ptr<ChunkSection>& section : chunk.sections)
+			section->Fill(0);
+		std::fill(std::begin(chunk.heightmap), std::end(chunk.heightmap), (int16_t)-1);
+		for (ColumnMask& column : chunk.opacity)
+			column.Reset();
+	}
+
+	/// <summary>
+	/// Sets each block in [zMin, zMax) to one of blockIDs with probability density, air otherwise
+	/// </summary>
+	inline void FillRandom(Chunk& chunk, std::mt19937& random, float density, int zMin, int zMax, int blockIDs) {
+		std::uniform_real_distribution<float> chance(0.0f, 1.0f);
+		for (int x = 0; x < 16; x++)
+			for (int y = 0; y < 16; y++)
+				for (int z = zMin; z < zMax; z++)
+					chunk.SetBlock(x, y, z, chance(random) < density ? 1 + (int)(random() % blockIDs) : 0);
+	}
+
+	/// <summary>
+	/// Faces a block at (x, y, z) shows, one GetBlock per neighbor. Above and below the column is air, past a missing neighbor is solid.
+	/// </summary>
+	inline FaceList Reference(const Chunk& chunk, const Neighbors& neighbors) {
+		//offsets in face index order, +y, -y, -x, +x, -z, +z
+		static const int offsets[6][3] = { { 0, 1, 0 }, { 0, -1, 0 }, { -1, 0, 0 }, { 1, 0, 0 }, { 0, 0, -1 }, { 0, 0, 1 } };
+		auto opaque = [&](int x, int y, int z) {
+			if (z < 0 || z > 255)
+				return false;
+			const Chunk* owner = &chunk;
+			if (y > 15)
+				owner = neighbors.sides[(int)ChunkSide::North];
+			else if (x > 15)
+				owner = neighbors.sides[(int)ChunkSide::East];
+			else if (y < 0)
+				owner = neighbors.sides[(int)ChunkSide::South];
+			else if (x < 0)
+				owner = neighbors.sides[(int)ChunkSide::West];
+			if (!owner)
+				return true;
+			return owner->GetBlock(x & 15, y & 15, z) != 0;
+		};
+		FaceList faces;
+		for (int x = 0; x < 16; x++) {
+			for (int y = 0; y < 16; y++) {
+				for (int z = 0; z < 256; z++) {
+					int block = chunk.GetBlock(x, y, z);
+					if (block == 0)
+						continue;
+					for (int face = 0; face < 6; face++) {
+						if (!opaque(x + offsets[face][0], y + offsets[face][1], z + offsets[face][2]))
+							faces.emplace_back(x, y, z, face, block);
+					}
+				}
+			}
+		}
+		std::sort(faces.begin(), faces.end());
+		return faces;
+	}
+
+	/// <summary>
+	/// Unit faces covered by the quads of the staged mesh. Also checks each quad is well formed and sits in the range of its face and section.
+	/// </summary>
+	inline FaceList Decode(const Chunk& chunk) {
+		FaceList faces;
+		const std::vector<Vertex>& vertices = chunk.staging;
+		CHECK_EQUAL(vertices.size(), (size_t)chunk.stagingOffsets[Chunk::RangeCount]);
+		CHECK_EQUAL(vertices.size() % 4, (size_t)0);
+		for (int range = 0; range < Chunk::RangeCount; range++) {
+			int face = range / Chunk::SectionCount;
+			int section = range % Chunk::SectionCount;
+			//the axis along the face normal, and whether the normal points along it
+			int axis = face < 2 ? 1 : face < 4 ? 0 : 2;
+			bool positive = face == 0 || face == 3 || face == 5;
+			for (uint32_t i = chunk.stagingOffsets[range]; i + 4 <= chunk.stagingOffsets[range + 1]; i += 4) {
+				int low[3] = { 1 << 30, 1 << 30, 1 << 30 };
+				int high[3] = { -1, -1, -1 };
+				int block = (int)vertices[i].Block();
+				for (uint32_t corner = 0; corner < 4; corner++) {
+					const Vertex& vertex = vertices[i + corner];
+					CHECK_EQUAL((int)vertex.Face(), face);
+					CHECK_EQUAL((int)vertex.Block(), block);
+					CHECK_EQUAL(vertex.Corner(), corner);
+					int position[3] = { (int)vertex.X(), (int)vertex.Y(), (int)vertex.Z() };
+					for (int a = 0; a < 3; a++) {
+						low[a] = std::min(low[a], position[a]);
+						high[a] = std::max(high[a], position[a]);
+					}
+				}
+				//the quad lies in a plane, the blocks it belongs to are on the inside of that plane
+				CHECK_EQUAL(low[axis], high[axis]);
+				low[axis] -= positive ? 1 : 0;
+				high[axis] = low[axis] + 1;
+				for (int x = low[0]; x < high[0]; x++) {
+					for (int y = low[1]; y < high[1]; y++) {
+						for (int z = low[2]; z < high[2]; z++) {
+							CHECK_EQUAL(z >> 4, section);
+							faces.emplace_back(x, y, z, face, block);
+						}
+					}
+				}
+			}
+		}
+		std::sort(faces.begin(), faces.end());
+		return faces;
+	}
+
+	/// <summary>
+	/// Meshes every section of the chunk into its staging vector and returns the faces covered.
+	/// The ring is never created, so the build always falls back to the staging vector.
+	/// </summary>
+	inline FaceList Mesh(Chunk& chunk, const Neighbors& neighbors, MeshingMode mode, size_t* vertexCount = nullptr) {
+		static StagingRing ring(std::make_unique<NullStagingBackend>());
+		chunk.dirtySections.store(0xFFFF);
+		chunk.TakeSnapshot(neighbors.sides[0], neighbors.sides[1], neighbors.sides[2], neighbors.sides[3]);
+		chunk.BuildMesh(ring, mode);
+		if (vertexCount)
+			*vertexCount = chunk.staging.size();
+		FaceList faces = Decode(chunk);
+		chunk.ReleaseStaging(ring);
+		return faces;
+	}
+
+	inline bool HasDuplicates(const FaceList& faces) {
+		return std::adjacent_find(faces.begin(), faces.end()) != faces.end();
+	}
+}
@@ -0,0 +1,98 @@
+#include "Test.h"
+#include "World/PaletteStorage.h"
+#include <random>
+
+namespace {
+    //the width PaletteStorage settles on for a palette of ids entries, the next power of two that indexes them all
+    int ExpectedBits(size_t ids) {
+        int bits = 0;
+        while (((size_t)1 << bits) < ids)
+            bits = bits == 0 ? 1 : bits * 2;
+        return bits;
+    }
+}
+
+TEST_CASE(PaletteStorageMatchesFlatArray) {
+    std::mt19937 random(1);
+    const size_t size = 16 * 16 * 256;
+    PaletteStorage storage(size);
+    std::vector<int> flat(size, 0);
+    //the set of ids grows as the run goes on, so every width change happens with the array full of earlier values
+    for (int idCount = 2; idCount <= 300; idCount += 7) {
+        for (int step = 0; step < 4000; step++) {
+            size_t index = random() % size;
+            int id = (int)(random() % idCount);
+            storage.Set(index, id);
+            flat[index] = id;
+        }
+        int mismatches = 0;
+        for (size_t i = 0; i < size; i++)
+            mismatches += storage.Get(i) != flat[i];
+        CHECK_EQUAL(mismatches, 0);
+        CHECK_EQUAL(storage.BitsPerIndex(), ExpectedBits(storage.Palette().size()));
+    }
+    CHECK_EQUAL(storage.Size(), size);
+}
+
+TEST_CASE(PaletteStorageWidensByPowersOfTwo) {
+    PaletteStorage storage(1024, 7);
+    CHECK_EQUAL(storage.BitsPerIndex(), 0);
+    CHECK_EQUAL(storage.Get(1023), 7);
+    //setting the id already there adds nothing
+    storage.Set(5, 7);
+    CHECK_EQUAL(storage.Palette().size(), (size_t)1);
+    //one new id per entry, 1 + 300 ids goes through 1, 2, 4, 8 and 16 bits
+    for (int id = 1; id <= 300; id++) {
+        storage.Set(id, 1000 + id);
+        CHECK_EQUAL(storage.BitsPerIndex(), ExpectedBits(id + 1));
+    }
+    CHECK_EQUAL(storage.BitsPerIndex(), 16);
+    for (int i = 0; i < 1024; i++)
+        CHECK_EQUAL(storage.Get(i), i >= 1 && i <= 300 ? 1000 + i : 7);
+}
+
+TEST_CASE(PaletteStorageFill) {
+    PaletteStorage storage(4096);
+    for (int i = 0; i < 4096; i++)
+        storage.Set(i, i % 5);
+    CHECK_EQUAL(storage.BitsPerIndex(), 4);
+    storage.Fill(3);
+    CHECK_EQUAL(storage.BitsPerIndex(), 0);
+    CHECK_EQUAL(storage.Palette().size(), (size_t)1);
+    bool filled = true;
+    for (int i = 0; i < 4096; i++)
+        filled = filled && storage.Get(i) == 3;
+    CHECK(filled);
+    //the storage widens again from scratch
+    storage.Set(10, 4);
+    CHECK_EQUAL(storage.BitsPerIndex(), 1);
+    CHECK_EQUAL(storage.Get(10), 4);
+    CHECK_EQUAL(storage.Get(11), 3);
+}
+
+TEST_CASE(PaletteStorageCompact) {
+    PaletteStorage storage(4096);
+    for (int i = 0; i < 4096; i++)
+        storage.Set(i, 1 + i % 20);
+    CHECK_EQUAL(storage.BitsPerIndex(), 8);
+    //overwrite all but three of the ids, the rest stay in the palette until Compact drops them
+    for (int i = 0; i < 4096; i++) {
+        if (storage.Get(i) > 3)
+            storage.Set(i, 2);
+    }
+    CHECK_EQUAL(storage.Palette().size(), (size_t)21);
+    storage.Compact();
+    CHECK_EQUAL(storage.Palette().size(), (size_t)3);
+    CHECK_EQUAL(storage.BitsPerIndex(), 2);
+    int mismatches = 0;
+    for (int i = 0; i < 4096; i++)
+        mismatches += storage.Get(i) != (1 + i % 20 > 3 ? 2 : 1 + i % 20);
+    CHECK_EQUAL(mismatches, 0);
+    //a single id left collapses back to 0 bits
+    for (int i = 0; i < 4096; i++)
+        storage.Set(i, 9);
+    storage.Compact();
+    CHECK_EQUAL(storage.BitsPerIndex(), 0);
+    CHECK_EQUAL(storage.Palette().size(), (size_t)1);
+    CHECK_EQUAL(storage.Get(100), 9);
+}
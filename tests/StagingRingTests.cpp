@@ -0,0 +1,173 @@
+#include "Test.h"
+#include "World/StagingRing.h"
+
+namespace {
+    //a ring over a NullStagingBackend, with the backend kept at hand to signal its fences
+    struct NullRing {
+        NullStagingBackend* backend;
+        StagingRing ring;
+
+        explicit NullRing(size_t capacity, bool signalImmediately = true) : backend(new NullStagingBackend()), ring(std::unique_ptr<StagingBackend>(backend)) {
+            backend->signalImmediately = signalImmediately;
+            ring.Create(capacity);
+        }
+        //releases the allocation and ends the frame, the way ChunkManager::Update does after copying out of it
+        void ReleaseAndSubmit(const StagingRing::Allocation& allocation) {
+            ring.Release(allocation);
+            ring.Submit();
+        }
+    };
+}
+
+TEST_CASE(StagingRingAllocatesInOrderWithoutWrapping) {
+    NullRing staging(1024);
+    CHECK_EQUAL(staging.ring.Capacity(), (size_t)1024);
+    StagingRing::Allocation a = staging.ring.Allocate(100);
+    StagingRing::Allocation b = staging.ring.Allocate(64);
+    StagingRing::Allocation c = staging.ring.Allocate(1);
+    CHECK(a && b && c);
+    //each allocation starts on the next cache line after the one before
+    CHECK_EQUAL(a.offset, (size_t)0);
+    CHECK_EQUAL(b.offset, (size_t)128);
+    CHECK_EQUAL(c.offset, (size_t)192);
+    CHECK(b.data == a.data + 128);
+    CHECK(c.data == a.data + 192);
+    CHECK_EQUAL(a.bytes, (size_t)100);
+    CHECK_EQUAL(b.position, (uint64_t)128);
+    StagingRing::Stats stats = staging.ring.GetStats();
+    CHECK_EQUAL(stats.used, (size_t)256);
+    CHECK_EQUAL(stats.allocations, (size_t)3);
+    CHECK_EQUAL(stats.failed, (uint64_t)0);
+    //all three released in one frame go back under one fence
+    staging.ring.Release(a);
+    staging.ring.Release(b);
+    staging.ring.Release(c);
+    staging.ring.Submit();
+    CHECK_EQUAL(staging.backend->LastFence(), (StagingBackend::Fence)1);
+    staging.ring.Retire();
+    stats = staging.ring.GetStats();
+    CHECK_EQUAL(stats.used, (size_t)0);
+    CHECK_EQUAL(stats.allocations, (size_t)0);
+    CHECK_EQUAL(stats.pendingFences, (size_t)0);
+    //the ring carries on from where it was rather than starting over at 0
+    CHECK_EQUAL(staging.ring.Allocate(64).offset, (size_t)256);
+}
+
+TEST_CASE(StagingRingSkipsPaddingAtTheEnd) {
+    NullRing staging(512);
+    StagingRing::Allocation a = staging.ring.Allocate(384);
+    StagingRing::Allocation b = staging.ring.Allocate(64);
+    CHECK_EQUAL(b.offset, (size_t)384);
+    staging.ReleaseAndSubmit(a);
+    staging.ring.Retire();
+    CHECK_EQUAL(staging.ring.GetStats().used, (size_t)64);
+    //128 bytes don't fit in the 64 left at the end, so they skip to the start and the 64 count as used
+    StagingRing::Allocation c = staging.ring.Allocate(128);
+    CHECK(c);
+    CHECK_EQUAL(c.offset, (size_t)0);
+    CHECK(c.data == a.data);
+    CHECK_EQUAL(c.position, (uint64_t)448);
+    StagingRing::Stats stats = staging.ring.GetStats();
+    CHECK_EQUAL(stats.used, (size_t)256);
+    CHECK_EQUAL(stats.allocations, (size_t)2);
+    //the padding goes back with the allocation after it
+    staging.ReleaseAndSubmit(b);
+    staging.ReleaseAndSubmit(c);
+    staging.ring.Retire();
+    CHECK_EQUAL(staging.ring.GetStats().used, (size_t)0);
+    //a full ring's worth fits again once it's all retired
+    CHECK_EQUAL(staging.ring.Allocate(512).offset, (size_t)0);
+}
+
+TEST_CASE(StagingRingRetiresInFenceOrder) {
+    NullRing staging(1024, false);
+    StagingRing::Allocation a = staging.ring.Allocate(64);
+    StagingRing::Allocation b = staging.ring.Allocate(64);
+    StagingRing::Allocation c = staging.ring.Allocate(64);
+    //a frame that releases nothing inserts no fence
+    staging.ring.Submit();
+    CHECK_EQUAL(staging.backend->LastFence(), (StagingBackend::Fence)0);
+
+    staging.ReleaseAndSubmit(a);
+    staging.ReleaseAndSubmit(b);
+    CHECK_EQUAL(staging.ring.GetStats().pendingFences, (size_t)2);
+    //neither fence has passed, nothing comes back
+    staging.ring.Retire();
+    CHECK_EQUAL(staging.ring.GetStats().allocations, (size_t)3);
+    CHECK_EQUAL(staging.ring.GetStats().pendingFences, (size_t)2);
+
+    //the first fence passes, only what was released before it comes back
+    staging.backend->Signal();
+    staging.ReleaseAndSubmit(c);
+    staging.ring.Retire();
+    StagingRing::Stats stats = staging.ring.GetStats();
+    CHECK_EQUAL(stats.allocations, (size_t)1);
+    CHECK_EQUAL(stats.used, (size_t)64);
+    CHECK_EQUAL(stats.pendingFences, (size_t)1);
+    staging.backend->Signal();
+    staging.ring.Retire();
+    CHECK_EQUAL(staging.ring.GetStats().allocations, (size_t)0);
+    CHECK_EQUAL(staging.ring.GetStats().pendingFences, (size_t)0);
+}
+
+TEST_CASE(StagingRingWaitsForEarlierAllocations) {
+    NullRing staging(1024);
+    StagingRing::Allocation a = staging.ring.Allocate(64);
+    StagingRing::Allocation b = staging.ring.Allocate(64);
+    StagingRing::Allocation c = staging.ring.Allocate(64);
+    //released out of order, its fence passes but a and b still hold the ring in front of it
+    staging.ReleaseAndSubmit(c);
+    staging.ring.Retire();
+    CHECK_EQUAL(staging.ring.GetStats().allocations, (size_t)3);
+    CHECK_EQUAL(staging.ring.GetStats().pendingFences, (size_t)0);
+    staging.ReleaseAndSubmit(a);
+    staging.ring.Retire();
+    CHECK_EQUAL(staging.ring.GetStats().allocations, (size_t)2);
+    //releasing b frees everything, c's space included
+    staging.ReleaseAndSubmit(b);
+    staging.ring.Retire();
+    CHECK_EQUAL(staging.ring.GetStats().allocations, (size_t)0);
+    CHECK_EQUAL(staging.ring.GetStats().used, (size_t)0);
+}
+
+TEST_CASE(StagingRingCountsFailedAllocations) {
+    StagingRing uncreated(std::make_unique<NullStagingBackend>());
+    CHECK(!uncreated.Allocate(64));
+    CHECK_EQUAL(uncreated.GetStats().failed, (uint64_t)1);
+
+    NullRing staging(256, false);
+    StagingRing::Allocation first = staging.ring.Allocate(64);
+    for (int i = 0; i < 3; i++)
+        CHECK(staging.ring.Allocate(64));
+    //full, the allocation fails instead of waiting and nothing changes
+    CHECK(!staging.ring.Allocate(1));
+    CHECK(!staging.ring.Allocate(512));
+    CHECK(!staging.ring.Allocate(0));
+    StagingRing::Stats stats = staging.ring.GetStats();
+    CHECK_EQUAL(stats.failed, (uint64_t)3);
+    CHECK_EQUAL(stats.used, (size_t)256);
+    CHECK_EQUAL(stats.allocations, (size_t)4);
+    //released but not fenced yet, still full
+    staging.ReleaseAndSubmit(first);
+    staging.ring.Retire();
+    CHECK(!staging.ring.Allocate(64));
+    CHECK_EQUAL(staging.ring.GetStats().failed, (uint64_t)4);
+    staging.backend->Signal();
+    staging.ring.Retire();
+    CHECK(staging.ring.Allocate(64));
+    CHECK_EQUAL(staging.ring.GetStats().failed, (uint64_t)4);
+}
+
+TEST_CASE(StagingRingDestroy) {
+    NullRing staging(256, false);
+    staging.ReleaseAndSubmit(staging.ring.Allocate(64));
+    staging.ring.Allocate(64);
+    staging.ring.Destroy();
+    CHECK(!staging.ring.IsCreated());
+    StagingRing::Stats stats = staging.ring.GetStats();
+    CHECK_EQUAL(stats.capacity, (size_t)0);
+    CHECK_EQUAL(stats.used, (size_t)0);
+    CHECK_EQUAL(stats.allocations, (size_t)0);
+    CHECK_EQUAL(stats.pendingFences, (size_t)0);
+    CHECK(!staging.ring.Allocate(64));
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// Minimal test registry. A TEST_CASE keeps running after a failed CHECK so one run reports every mismatch.
+/// </summary>
+namespace Testing {
+	struct TestCase {
+		const char* name;
+		void (*run)();
+	};
+
+	inline std::vector<TestCase>& Registry() {
+		static std::vector<TestCase> registry;
+		return registry;
+	}
+
+	/// <summary>
+	/// Failed checks of the test case being run
+	/// </summary>
+	inline int failures = 0;
+
+	struct Registrar {
+		Registrar(const char* name, void (*run)()) {
+			Registry().push_back({ name, run });
+		}
+	};
+
+	inline void Fail(const std::string& message, const char* file, int line) {
+		failures++;
+		std::printf("  %s:%d: %s\n", file, line, message.c_str());
+	}
+
+	template<typename A, typename B>
+	void CheckEqual(const A& actual, const B& expected, const char* actualText, const char* expectedText, const char* file, int line) {
+		if (actual == expected)
+			return;
+		std::ostringstream message;
+		message << actualText << " == " << expectedText << " failed, " << actual << " != " << expected;
+		Fail(message.str(), file, line);
+	}
+}
+
+#define TEST_CASE(name) \
+	static void name(); \
+	static Testing::Registrar name##Registrar(#name, name); \
+	static void name()
+
+#define CHECK(expression) \
+	do { \
+		if (!(expression)) \
+			Testing::Fail("CHECK(" #expression ") failed", __FILE__, __LINE__); \
+	} while (0)
+
+#define CHECK_EQUAL(actual, expected) Testing::CheckEqual((actual), (expected), #actual, #expected, __FILE__, __LINE__)
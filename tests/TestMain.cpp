@@ -0,0 +1,24 @@
+#include "Test.h"
+#include <cstring>
+
+//Runs every test case, or only those whose name contains the first argument. Exits non zero if any failed.
+int main(int argc, char** argv) {
+    const char* filter = argc > 1 ? argv[1] : nullptr;
+    int run = 0, failed = 0;
+    for (const Testing::TestCase& test : Testing::Registry()) {
+        if (filter && !std::strstr(test.name, filter))
+            continue;
+        Testing::failures = 0;
+        test.run();
+        run++;
+        if (Testing::failures) {
+            failed++;
+            std::printf("FAILED %s (%d checks)\n", test.name, Testing::failures);
+        }
+        else {
+            std::printf("ok     %s\n", test.name);
+        }
+    }
+    std::printf("%d of %d test cases passed\n", run - failed, run);
+    return failed ? 1 : 0;
+}